@@ -93,6 +93,23 @@ std::wstring GetFileLastModifiedDate(const std::wstring& path) {
   return std::wstring();
 }
 
+QWORD GetFileLastWriteTime(const std::wstring& path) {
+  Handle file_handle{OpenFileForGenericRead(path)};
+
+  if (file_handle.get() == INVALID_HANDLE_VALUE)
+    return 0;
+
+  FILETIME ft_file;
+  if (!GetFileTime(file_handle.get(), nullptr, nullptr, &ft_file))
+    return 0;
+
+  ULARGE_INTEGER ul_file;
+  ul_file.LowPart = ft_file.dwLowDateTime;
+  ul_file.HighPart = ft_file.dwHighDateTime;
+
+  return ul_file.QuadPart;
+}
+
 QWORD GetFileSize(const std::wstring& path) {
   QWORD file_size = 0;
 
@@ -412,6 +429,27 @@ int PopulateFolders(std::vector<std::wstring>& folder_list,
 
 ////////////////////////////////////////////////////////////////////////////////
 
+bool AppendToFile(const std::string& data, const std::wstring& path) {
+  if (data.empty())
+    return false;
+
+  // Make sure the path is available
+  CreateFolder(GetPathOnly(path));
+
+  Handle file_handle{::CreateFile(GetExtendedLengthPath(path).c_str(),
+                                  FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+                                  OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)};
+  if (file_handle.get() == INVALID_HANDLE_VALUE)
+    return false;
+
+  DWORD bytes_written = 0;
+  const BOOL result = ::WriteFile(file_handle.get(), data.data(),
+                                  static_cast<DWORD>(data.size()),
+                                  &bytes_written, nullptr);
+
+  return result != FALSE && bytes_written == data.size();
+}
+
 bool ReadFromFile(const std::wstring& path, std::string& output) {
   Handle file_handle{OpenFileForGenericRead(path)};
 
@@ -463,6 +501,67 @@ bool SaveToFile(const std::string& data, const std::wstring& path,
 
 ////////////////////////////////////////////////////////////////////////////////
 
+FileMapping::~FileMapping() {
+  Close();
+}
+
+bool FileMapping::Open(const std::wstring& path) {
+  Close();
+
+  file_handle_ = OpenFileForGenericRead(path);
+  if (file_handle_ == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size{};
+  if (::GetFileSizeEx(file_handle_, &file_size) == FALSE ||
+      file_size.QuadPart == 0) {
+    Close();
+    return false;
+  }
+
+  mapping_handle_ = ::CreateFileMapping(file_handle_, nullptr, PAGE_READONLY,
+                                        0, 0, nullptr);
+  if (!mapping_handle_) {
+    Close();
+    return false;
+  }
+
+  view_ = ::MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0);
+  if (!view_) {
+    Close();
+    return false;
+  }
+
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  return true;
+}
+
+void FileMapping::Close() {
+  if (view_) {
+    ::UnmapViewOfFile(view_);
+    view_ = nullptr;
+  }
+  if (mapping_handle_) {
+    ::CloseHandle(mapping_handle_);
+    mapping_handle_ = nullptr;
+  }
+  if (file_handle_ != INVALID_HANDLE_VALUE) {
+    ::CloseHandle(file_handle_);
+    file_handle_ = INVALID_HANDLE_VALUE;
+  }
+  size_ = 0;
+}
+
+const BYTE* FileMapping::data() const {
+  return static_cast<const BYTE*>(view_);
+}
+
+size_t FileMapping::size() const {
+  return size_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 enum Unit : UINT64 {
   kKB  = 1000,
   kKiB = 1024,
@@ -29,6 +29,7 @@
 
 unsigned long GetFileAge(const std::wstring& path);
 std::wstring GetFileLastModifiedDate(const std::wstring& path);
+QWORD GetFileLastWriteTime(const std::wstring& path);
 QWORD GetFileSize(const std::wstring& path);
 QWORD GetFolderSize(const std::wstring& path, bool recursive);
 
@@ -59,10 +60,31 @@ std::wstring GetFinalPath(const std::wstring& path);
 unsigned int PopulateFiles(std::vector<std::wstring>& file_list, const std::wstring& path, const std::wstring& extension = L"", bool recursive = false, bool trim_extension = false);
 int PopulateFolders(std::vector<std::wstring>& folder_list, const std::wstring& path);
 
+bool AppendToFile(const std::string& data, const std::wstring& path);
 bool ReadFromFile(const std::wstring& path, std::string& output);
 bool SaveToFile(LPCVOID data, DWORD length, const std::wstring& path, bool take_backup = false);
 bool SaveToFile(const std::string& data, const std::wstring& path, bool take_backup = false);
 
+class FileMapping {
+public:
+  FileMapping() {}
+  FileMapping(const FileMapping&) = delete;
+  FileMapping& operator=(const FileMapping&) = delete;
+  ~FileMapping();
+
+  bool Open(const std::wstring& path);
+  void Close();
+
+  const BYTE* data() const;
+  size_t size() const;
+
+private:
+  HANDLE file_handle_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_handle_ = nullptr;
+  LPVOID view_ = nullptr;
+  size_t size_ = 0;
+};
+
 UINT64 ParseSizeString(std::wstring value);
 std::wstring ToSizeString(const UINT64 size);
 
@@ -22,38 +22,88 @@
 
 #include "gzip.h"
 
-bool UncompressGzippedString(const std::string& input, std::string& output) {
-  z_stream stream;
-  stream.zalloc = Z_NULL;
-  stream.zfree = Z_NULL;
-  stream.opaque = NULL;
-  stream.total_out = 0;
-  stream.next_in = (BYTE*)&input[0];
-  stream.avail_in = input.length();
-
-  if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK)
+GzipDecoder::GzipDecoder()
+    : stream_(new z_stream),
+      failed_(false),
+      finished_(false),
+      initialized_(false) {
+}
+
+GzipDecoder::~GzipDecoder() {
+  Reset();
+}
+
+bool GzipDecoder::Write(const char* data, size_t size, std::string& output) {
+  if (failed_)
     return false;
+  if (finished_)
+    return true;  // Ignore trailing data
+
+  if (!initialized_) {
+    stream_->zalloc = Z_NULL;
+    stream_->zfree = Z_NULL;
+    stream_->opaque = Z_NULL;
+    stream_->next_in = Z_NULL;
+    stream_->avail_in = 0;
+    // Adding 32 enables automatic detection of gzip and zlib headers
+    if (inflateInit2(stream_.get(), MAX_WBITS + 32) != Z_OK) {
+      failed_ = true;
+      return false;
+    }
+    initialized_ = true;
+  }
 
-  size_t buffer_length = input.length() * 2;
-  char* buffer = (char*)GlobalAlloc(GMEM_ZEROINIT, buffer_length);
+  stream_->next_in = (Bytef*)data;
+  stream_->avail_in = static_cast<uInt>(size);
 
-  size_t total_length = 0;
-  int status = Z_OK;
+  char buffer[16384];
 
   do {
-    stream.next_out = (BYTE*)buffer;
-    stream.avail_out = buffer_length;
-    status = inflate(&stream, Z_SYNC_FLUSH);
-    if (status == Z_OK || status == Z_STREAM_END) {
-      output.append(buffer, stream.total_out - total_length);
-      total_length = stream.total_out;
+    stream_->next_out = (Bytef*)buffer;
+    stream_->avail_out = sizeof(buffer);
+
+    const int status = inflate(stream_.get(), Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+      failed_ = true;
+      return false;
     }
-  } while (status == Z_OK);
 
-  GlobalFree(buffer);
-  inflateEnd(&stream);
+    output.append(buffer, sizeof(buffer) - stream_->avail_out);
+
+    if (status == Z_STREAM_END) {
+      finished_ = true;
+      break;
+    }
+    if (status == Z_BUF_ERROR)
+      break;  // Needs more input
+  } while (stream_->avail_in > 0 || stream_->avail_out == 0);
+
+  return true;
+}
 
-  return status == Z_STREAM_END;
+void GzipDecoder::Reset() {
+  if (initialized_)
+    inflateEnd(stream_.get());
+
+  failed_ = false;
+  finished_ = false;
+  initialized_ = false;
+}
+
+bool GzipDecoder::failed() const {
+  return failed_;
+}
+
+bool GzipDecoder::finished() const {
+  return finished_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool UncompressGzippedString(const std::string& input, std::string& output) {
+  GzipDecoder decoder;
+  decoder.Write(input.data(), input.size(), output);
+  return decoder.finished();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
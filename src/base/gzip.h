@@ -18,8 +18,31 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 
+struct z_stream_s;
+
+// Decompresses gzipped data as it arrives, so that we don't have to keep the
+// compressed data around
+class GzipDecoder {
+public:
+  GzipDecoder();
+  ~GzipDecoder();
+
+  bool Write(const char* data, size_t size, std::string& output);
+  void Reset();
+
+  bool failed() const;
+  bool finished() const;
+
+private:
+  std::unique_ptr<z_stream_s> stream_;
+  bool failed_;
+  bool finished_;
+  bool initialized_;
+};
+
 bool UncompressGzippedString(const std::string& input, std::string& output);
 
 bool DeflateString(const std::string& input, std::string& output);
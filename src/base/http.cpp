@@ -28,7 +28,7 @@ Request::Request()
 }
 
 Response::Response()
-    : code(0), parameter(0) {
+    : body_text_available_(false), code(0), parameter(0) {
 }
 
 void Request::Clear() {
@@ -43,6 +43,20 @@ void Response::Clear() {
   code = 0;
   header.clear();
   body.clear();
+  body.shrink_to_fit();
+  body_text_.clear();
+  body_text_.shrink_to_fit();
+  body_text_available_ = false;
+}
+
+const std::wstring& Response::GetBodyText() const {
+  // Decoded on first use, as most responses are parsed as UTF-8 directly
+  if (!body_text_available_) {
+    body_text_ = StrToWstr(body);
+    body_text_available_ = true;
+  }
+
+  return body_text_;
 }
 
 unsigned int Response::GetStatusCategory() const {
@@ -96,10 +110,6 @@ void Client::Cleanup(bool reuse) {
     curl_slist_free_all(header_list_);
     header_list_ = nullptr;
   }
-  if (GetThreadHandle() &&
-      GetThreadId() != GetCurrentThreadId()) {
-    CloseThreadHandle();
-  }
 
   // Clear request and response
   if (!reuse)
@@ -108,14 +118,16 @@ void Client::Cleanup(bool reuse) {
 
   // Clear buffers
   optional_data_.clear();
-  write_buffer_.clear();
+  gzip_decoder_.Reset();
 
   // Reset variables
-  busy_ = false;
   cancel_ = false;
   content_encoding_ = ContentEncoding::None;
   content_length_ = 0;
   current_length_ = 0;
+
+  // The client may be reused by another thread from this point on
+  busy_ = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -18,7 +18,7 @@
 
 #pragma once
 
-// Each client will have its own thread
+// Transfers are driven by a background thread (see EventLoop)
 #define TAIGA_HTTP_MULTITHREADED
 
 #ifdef _DEBUG
@@ -33,13 +33,19 @@
 #define HTTP_ONLY
 #endif
 
-#include <windows.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <curl/include/curl/curl.h>
-#include <windows/win/thread.h>
 
+#include "gzip.h"
 #include "map.h"
 #include "url.h"
 
@@ -70,7 +76,7 @@ public:
   query_t data;
 
   std::wstring uid;
-  LPARAM parameter;
+  intptr_t parameter;
 };
 
 class Response {
@@ -79,15 +85,20 @@ public:
   virtual ~Response() {}
 
   void Clear();
+  const std::wstring& GetBodyText() const;
   unsigned int GetStatusCategory() const;
 
   unsigned int code;
 
   header_t header;
-  std::wstring body;
+  std::string body;  // Raw (and decompressed) bytes, usually UTF-8
 
   std::wstring uid;
-  LPARAM parameter;
+  intptr_t parameter;
+
+private:
+  mutable std::wstring body_text_;
+  mutable bool body_text_available_;
 };
 
 std::wstring GenerateRequestId();
@@ -105,8 +116,12 @@ private:
   bool initialized_;
 };
 
-class Client : public win::Thread {
+class EventLoop;
+
+class Client {
 public:
+  friend class EventLoop;
+
   Client(const Request& request);
   virtual ~Client();
 
@@ -139,7 +154,7 @@ public:
   virtual void OnReadComplete() {}
   virtual bool OnRedirect(const std::wstring& address, bool refresh) { return false; }
 
-  DWORD ThreadProc();
+  static EventLoop& event_loop();
 
 protected:
   Request request_;
@@ -148,7 +163,7 @@ protected:
   ContentEncoding content_encoding_;
   curl_off_t content_length_;
   curl_off_t current_length_;
-  std::string write_buffer_;
+  GzipDecoder gzip_decoder_;
 
   bool allow_reuse_;
   bool auto_redirect_;
@@ -171,6 +186,7 @@ private:
   bool SetRequestOptions();
   bool SendRequest();
   bool Perform();
+  bool Finish(CURLcode code);
 
   void BuildRequestHeader();
   bool GetResponseHeader(const std::wstring& header);
@@ -186,5 +202,64 @@ private:
   std::string optional_data_;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+
+// Drives all transfers from a single thread via a curl multi handle, instead
+// of having a thread for each request. Connections and DNS results are pooled
+// by the multi handle, TLS sessions are shared between transfers, and the
+// connection limits are enforced by libcurl, which queues the excess. The
+// loop itself has no platform-specific code.
+//
+// The event loop thread is only used for I/O. Completion callbacks are run by
+// a few worker threads, so that a slow handler does not hold up the other
+// transfers.
+
+class EventLoop {
+public:
+  EventLoop();
+  ~EventLoop();
+
+  bool Add(Client& client);
+  void Join();
+  void Stop();
+
+private:
+  // Workers are detached, and share the ownership of this state with the
+  // event loop, as they might be in the middle of a callback when the loop is
+  // destroyed.
+  struct Completions {
+    std::deque<std::pair<Client*, CURLcode>> queue;
+    std::condition_variable condition;
+    std::mutex mutex;
+    size_t idle_workers = 0;
+    size_t workers = 0;
+    bool stop = false;
+  };
+
+  bool Initialize();
+  void Run();
+  void AddPendingClients();
+  void ReadMessages();
+  void Complete(Client& client, CURLcode code);
+  void Wakeup();
+
+  static void RunWorker(std::shared_ptr<Completions> completions);
+
+  CURLM* multi_handle_;
+  CURLSH* share_handle_;
+
+  // Only accessed from the event loop thread
+  std::map<CURL*, Client*> clients_;
+
+  std::vector<Client*> pending_clients_;
+  std::condition_variable condition_;
+  std::mutex mutex_;
+  bool running_;
+  bool stop_;
+  std::thread thread_;
+
+  std::shared_ptr<Completions> completions_;
+};
+
 }  // namespace http
 }  // namespace base
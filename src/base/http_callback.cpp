@@ -16,6 +16,8 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "file.h"
 #include "http.h"
 #include "log.h"
@@ -59,7 +61,20 @@ size_t Client::WriteFunction(char* ptr, size_t size, size_t nmemb,
   if (client->cancel_)
     return 0;
 
-  client->write_buffer_.append(ptr, data_size);
+  auto& body = client->response_.body;
+
+  if (client->content_encoding_ == ContentEncoding::Gzip) {
+    // Decompress as we go, rather than keeping the compressed data around.
+    // Invalid data is ignored, leaving us with whatever could be decoded.
+    client->gzip_decoder_.Write(ptr, data_size, body);
+  } else {
+    // Avoid reallocations, without trusting the server with too much memory
+    const curl_off_t kMaxReservedLength = 64 * 1024 * 1024;
+    if (body.empty() && client->content_length_ > 0)
+      body.reserve(static_cast<size_t>(
+          std::min(client->content_length_, kMaxReservedLength)));
+    body.append(ptr, data_size);
+  }
 
   return data_size;
 }
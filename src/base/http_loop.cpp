@@ -0,0 +1,295 @@
+/*
+** Taiga
+** Copyright (C) 2010-2018, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+
+#include "http.h"
+#include "log.h"
+
+namespace base {
+namespace http {
+
+// These are the values commonly used by today's web browsers.
+// See: http://www.browserscope.org/?category=network
+constexpr long kMaxSimultaneousConnections = 10;
+constexpr long kMaxSimultaneousConnectionsPerHostname = 6;
+
+// curl_multi_poll and curl_multi_wakeup are available since libcurl 7.68.0.
+// With older versions, we have to poll more often to pick up new requests.
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define TAIGA_HTTP_MULTI_WAKEUP
+constexpr int kWaitTimeout = 1000;  // milliseconds
+#else
+constexpr int kWaitTimeout = 50;  // milliseconds
+#endif
+
+// Completion callbacks may take a while (e.g. parsing a large library), but
+// most of them are quick, so a few workers are enough to keep up.
+constexpr size_t kMaxCompletionWorkers = 4;
+
+// The event loop thread may be blocked by a callback that is waiting for the
+// thread that is trying to join it, in which case we give up waiting.
+constexpr auto kJoinTimeout = std::chrono::seconds(3);
+
+EventLoop& Client::event_loop() {
+  static EventLoop event_loop;
+  return event_loop;
+}
+
+EventLoop::EventLoop()
+    : multi_handle_(nullptr),
+      share_handle_(nullptr),
+      running_(false),
+      stop_(false),
+      completions_(std::make_shared<Completions>()) {
+}
+
+EventLoop::~EventLoop() {
+  // Join() is expected to be called beforehand. We don't wait for the thread
+  // during static destruction, as other threads might already be gone.
+  Stop();
+
+  if (thread_.joinable())
+    thread_.detach();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool EventLoop::Add(Client& client) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (stop_)
+    return false;
+
+  // The thread is started along with the first request
+  if (!multi_handle_) {
+    if (!Initialize())
+      return false;
+    running_ = true;
+    thread_ = std::thread(&EventLoop::Run, this);
+  }
+
+  pending_clients_.push_back(&client);
+  Wakeup();
+
+  return true;
+}
+
+void EventLoop::Join() {
+  // Transfers should be cancelled before calling Stop() and Join(), so that
+  // the event loop thread does not make any more callbacks.
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (!thread_.joinable())
+    return;
+
+  const bool finished = condition_.wait_for(lock, kJoinTimeout, [this]() {
+    return !running_;
+  });
+
+  if (finished) {
+    thread_.join();
+  } else {
+    LOGW(L"Event loop thread did not exit in time.");
+    thread_.detach();
+  }
+}
+
+void EventLoop::Stop() {
+  // We don't wait for the threads here; see Join(). Completions that have not
+  // been picked up by a worker are abandoned, along with unfinished transfers.
+  {
+    std::lock_guard<std::mutex> lock(completions_->mutex);
+    completions_->stop = true;
+    completions_->condition.notify_all();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  stop_ = true;
+  Wakeup();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool EventLoop::Initialize() {
+  multi_handle_ = curl_multi_init();
+  if (!multi_handle_)
+    return false;
+
+  curl_multi_setopt(multi_handle_, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                    kMaxSimultaneousConnections);
+  curl_multi_setopt(multi_handle_, CURLMOPT_MAX_HOST_CONNECTIONS,
+                    kMaxSimultaneousConnectionsPerHostname);
+
+  // Connections and DNS results are already shared by the multi handle
+  share_handle_ = curl_share_init();
+  if (share_handle_)
+    curl_share_setopt(share_handle_, CURLSHOPT_SHARE,
+                      CURL_LOCK_DATA_SSL_SESSION);
+
+  return true;
+}
+
+void EventLoop::Run() {
+  int running_handles = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      // Sleep until there is something to do
+      condition_.wait(lock, [&]() {
+        return stop_ || !pending_clients_.empty() || running_handles > 0;
+      });
+      if (stop_)
+        break;
+    }
+
+    AddPendingClients();
+
+    curl_multi_perform(multi_handle_, &running_handles);
+
+    ReadMessages();
+
+    if (running_handles > 0) {
+#ifdef TAIGA_HTTP_MULTI_WAKEUP
+      curl_multi_poll(multi_handle_, nullptr, 0, kWaitTimeout, nullptr);
+#else
+      curl_multi_wait(multi_handle_, nullptr, 0, kWaitTimeout, nullptr);
+#endif
+    }
+  }
+
+  // Unfinished transfers are abandoned
+  for (const auto& pair : clients_) {
+    curl_multi_remove_handle(multi_handle_, pair.first);
+    curl_easy_setopt(pair.first, CURLOPT_SHARE, nullptr);
+  }
+  clients_.clear();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (share_handle_) {
+    curl_share_cleanup(share_handle_);
+    share_handle_ = nullptr;
+  }
+  curl_multi_cleanup(multi_handle_);
+  multi_handle_ = nullptr;
+
+  running_ = false;
+  condition_.notify_all();
+}
+
+void EventLoop::AddPendingClients() {
+  std::vector<Client*> pending_clients;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(pending_clients, pending_clients_);
+  }
+
+  for (auto client : pending_clients) {
+    CURL* handle = client->curl_handle_;
+    if (share_handle_)
+      curl_easy_setopt(handle, CURLOPT_SHARE, share_handle_);
+    if (curl_multi_add_handle(multi_handle_, handle) != CURLM_OK) {
+      LOGE(L"Could not add transfer. ID: {}", client->request_.uid);
+      curl_easy_setopt(handle, CURLOPT_SHARE, nullptr);
+      Complete(*client, CURLE_FAILED_INIT);
+      continue;
+    }
+    clients_[handle] = client;
+  }
+}
+
+void EventLoop::ReadMessages() {
+  int message_count = 0;
+
+  while (CURLMsg* message = curl_multi_info_read(multi_handle_,
+                                                 &message_count)) {
+    if (message->msg != CURLMSG_DONE)
+      continue;
+
+    // The message is no longer valid after the handle is removed
+    CURL* handle = message->easy_handle;
+    const CURLcode result = message->data.result;
+
+    curl_multi_remove_handle(multi_handle_, handle);
+    curl_easy_setopt(handle, CURLOPT_SHARE, nullptr);
+
+    auto it = clients_.find(handle);
+    if (it == clients_.end())
+      continue;
+    Client* client = it->second;
+    clients_.erase(it);
+
+    Complete(*client, result);
+  }
+}
+
+void EventLoop::Complete(Client& client, CURLcode code) {
+  std::lock_guard<std::mutex> lock(completions_->mutex);
+
+  completions_->queue.emplace_back(&client, code);
+
+  if (!completions_->idle_workers &&
+      completions_->workers < kMaxCompletionWorkers) {
+    completions_->workers++;
+    std::thread(&EventLoop::RunWorker, completions_).detach();
+  } else {
+    completions_->condition.notify_one();
+  }
+}
+
+void EventLoop::Wakeup() {
+  // Join() might be waiting on the same condition
+  condition_.notify_all();
+
+#ifdef TAIGA_HTTP_MULTI_WAKEUP
+  if (multi_handle_)
+    curl_multi_wakeup(multi_handle_);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void EventLoop::RunWorker(std::shared_ptr<Completions> completions) {
+  std::unique_lock<std::mutex> lock(completions->mutex);
+
+  while (true) {
+    completions->idle_workers++;
+    completions->condition.wait(lock, [&]() {
+      return completions->stop || !completions->queue.empty();
+    });
+    completions->idle_workers--;
+    if (completions->stop)
+      break;
+
+    const auto completion = completions->queue.front();
+    completions->queue.pop_front();
+
+    // Completion callbacks are free to make new requests
+    lock.unlock();
+    completion.first->Finish(completion.second);
+    lock.lock();
+  }
+
+  completions->workers--;
+}
+
+}  // namespace http
+}  // namespace base
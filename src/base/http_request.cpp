@@ -18,7 +18,6 @@
 
 #include "file.h"
 #include "http.h"
-#include "gzip.h"
 #include "log.h"
 #include "string.h"
 #include "url.h"
@@ -174,6 +173,11 @@ bool Client::SetRequestOptions() {
   // Complete connection within 30 seconds (default is 300 seconds)
   TAIGA_CURL_SET_OPTION(CURLOPT_CONNECTTIMEOUT, 30L);
 
+  // Connections are kept in a shared pool, unless we're told otherwise
+  if (!allow_reuse_) {
+    TAIGA_CURL_SET_OPTION(CURLOPT_FORBID_REUSE, 1L);
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   // Security options
 
@@ -194,25 +198,21 @@ bool Client::SetRequestOptions() {
 
 bool Client::SendRequest() {
 #ifdef TAIGA_HTTP_MULTITHREADED
-  return CreateThread(nullptr, 0, 0);
+  return event_loop().Add(*this);
 #else
   return Perform();
 #endif
 }
 
 bool Client::Perform() {
-  CURLcode code = curl_easy_perform(curl_handle_);
+  return Finish(curl_easy_perform(curl_handle_));
+}
 
+bool Client::Finish(CURLcode code) {
   if (code == CURLE_OK) {
-    if (!write_buffer_.empty()) {
-      if (content_encoding_ == ContentEncoding::Gzip) {
-        std::string compressed;
-        std::swap(write_buffer_, compressed);
-        UncompressGzippedString(compressed, write_buffer_);
-        if (debug_mode_)
-          DebugHandler(CURLINFO_DATA_IN, write_buffer_, true);
-      }
-      response_.body = StrToWstr(write_buffer_);
+    if (content_encoding_ == ContentEncoding::Gzip && debug_mode_ &&
+        !response_.body.empty()) {
+      DebugHandler(CURLINFO_DATA_IN, response_.body, true);
     }
 
     OnReadComplete();
@@ -226,10 +226,6 @@ bool Client::Perform() {
   return code == CURLE_OK;
 }
 
-DWORD Client::ThreadProc() {
-  return Perform();
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 
 void Client::BuildRequestHeader() {
@@ -36,6 +36,17 @@ Setting::Setting(bool attribute,
       path(path) {
 }
 
+void Setting::SetValue(const std::wstring& new_value) {
+  value = new_value;
+
+  bool_value = ToBool(value);
+  int_value = ToInt(value);
+
+  list_value.clear();
+  if (!list_separator.empty() && !value.empty())
+    Split(value, list_separator, list_value);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 const std::wstring& Settings::operator[](enum_t name) const {
@@ -43,42 +54,38 @@ const std::wstring& Settings::operator[](enum_t name) const {
 }
 
 bool Settings::GetBool(enum_t name) const {
-  auto it = map_.find(name);
-
-  if (it != map_.end())
-    return ToBool(it->second.value);
-
-  return false;
+  return name < items_.size() ? items_[name].bool_value : false;
 }
 
 int Settings::GetInt(enum_t name) const {
-  auto it = map_.find(name);
-
-  if (it != map_.end())
-    return ToInt(it->second.value);
-
-  return 0;
+  return name < items_.size() ? items_[name].int_value : 0;
 }
 
 const std::wstring& Settings::GetWstr(enum_t name) const {
-  auto it = map_.find(name);
-
-  if (it != map_.end())
-    return it->second.value;
+  return name < items_.size() ? items_[name].value : EmptyString();
+}
 
-  return EmptyString();
+const std::vector<std::wstring>& Settings::GetList(enum_t name) const {
+  static const std::vector<std::wstring> empty_list;
+  return name < items_.size() ? items_[name].list_value : empty_list;
 }
 
 void Settings::Set(enum_t name, bool value) {
-  map_[name].value = value ? L"true" : L"false";
+  Set(name, std::wstring(value ? L"true" : L"false"));
 }
 
 void Settings::Set(enum_t name, int value) {
-  map_[name].value = ToWstr(value);
+  Set(name, ToWstr(value));
 }
 
 void Settings::Set(enum_t name, const std::wstring& value) {
-  map_[name].value = value;
+  auto& item = GetSetting(name);
+
+  if (item.value == value)
+    return;
+
+  item.SetValue(value);
+  NotifyObservers(name);
 }
 
 bool Settings::Toggle(enum_t name) {
@@ -87,17 +94,44 @@ bool Settings::Toggle(enum_t name) {
   return value;
 }
 
+void Settings::AddObserver(enum_t name, observer_t observer) {
+  observers_.push_back(std::make_pair(name, observer));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
+Setting& Settings::GetSetting(enum_t name) {
+  if (name >= items_.size())
+    items_.resize(name + 1);
+
+  return items_[name];
+}
+
+void Settings::NotifyObservers(enum_t name) const {
+  for (const auto& pair : observers_) {
+    if (pair.first == name)
+      pair.second(name);
+  }
+}
+
 void Settings::InitializeKey(enum_t name, const wchar_t* default_value,
                              const std::wstring& path) {
+  auto& item = GetSetting(name);
+
   if (default_value) {
-    map_.insert(std::make_pair(name, base::Setting(true, default_value, path)));
+    item = base::Setting(true, default_value, path);
   } else {
-    map_.insert(std::make_pair(name, base::Setting(true, path)));
+    item = base::Setting(true, path);
   }
 }
 
+void Settings::InitializeList(enum_t name, const std::wstring& separator) {
+  auto& item = GetSetting(name);
+
+  item.list_separator = separator;
+  item.SetValue(item.value);
+}
+
 std::wstring Settings::ReadValue(const xml_node& node_parent,
                                  const std::wstring& path,
                                  const bool attribute,
@@ -120,13 +154,13 @@ std::wstring Settings::ReadValue(const xml_node& node_parent,
 }
 
 void Settings::ReadValue(const xml_node& node_parent, enum_t name) {
-  Setting& item = map_[name];
-  item.value = ReadValue(node_parent, item.path,
-                         item.attribute, item.default_value);
+  const Setting& item = GetSetting(name);
+  Set(name, ReadValue(node_parent, item.path,
+                      item.attribute, item.default_value));
 }
 
 void Settings::WriteValue(const xml_node& node_parent, enum_t name) {
-  Setting& item = map_[name];
+  const Setting& item = GetSetting(name);
 
   std::vector<std::wstring> node_names;
   Split(item.path, L"/", node_names);
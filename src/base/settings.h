@@ -18,8 +18,10 @@
 
 #pragma once
 
-#include <map>
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "types.h"
 
@@ -36,27 +38,43 @@ public:
   Setting(bool attribute, const std::wstring& default_value, const std::wstring& path);
   ~Setting() {}
 
+  void SetValue(const std::wstring& new_value);
+
   bool attribute;
   std::wstring default_value;
   std::wstring path;
   std::wstring value;
+
+  // Typed values are parsed whenever the value changes, so that reading them
+  // doesn't have to
+  bool bool_value = false;
+  int int_value = 0;
+  std::wstring list_separator;
+  std::vector<std::wstring> list_value;
 };
 
 class Settings {
 public:
+  typedef std::function<void(enum_t name)> observer_t;
+
   const std::wstring& operator[](enum_t name) const;
 
   bool GetBool(enum_t name) const;
   int GetInt(enum_t name) const;
   const std::wstring& GetWstr(enum_t name) const;
+  const std::vector<std::wstring>& GetList(enum_t name) const;
 
   void Set(enum_t name, bool value);
   void Set(enum_t name, int value);
   void Set(enum_t name, const std::wstring& value);
   bool Toggle(enum_t name);
 
+  // Observers are called after the value of a setting is changed
+  void AddObserver(enum_t name, observer_t observer);
+
 protected:
   void InitializeKey(enum_t name, const wchar_t* default_value, const std::wstring& path);
+  void InitializeList(enum_t name, const std::wstring& separator);
   std::wstring ReadValue(const pugi::xml_node& node_parent, const std::wstring& path,
                          const bool attribute, const std::wstring& default_value);
   void ReadValue(const pugi::xml_node& node_parent, enum_t name);
@@ -64,7 +82,14 @@ protected:
 
   virtual void InitializeMap() = 0;
 
-  std::map<enum_t, Setting> map_;
+  // Settings are indexed by their names, which are consecutive values
+  std::vector<Setting> items_;
+
+private:
+  Setting& GetSetting(enum_t name);
+  void NotifyObservers(enum_t name) const;
+
+  std::vector<std::pair<enum_t, observer_t>> observers_;
 };
 
 }  // namespace base
@@ -17,8 +17,10 @@
 */
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <iomanip>
+#include <iterator>
 #include <locale>
 #include <map>
 #include <regex>
@@ -222,6 +224,10 @@ bool IsWhitespace(const wchar_t c) {
   return c == ' ' || c == '\r' || c == '\n' || c == '\t';
 }
 
+bool StartsWith(const string& str1, const string& str2) {
+  return str1.compare(0, str2.length(), str2) == 0;
+}
+
 bool StartsWith(const wstring& str1, const wstring& str2) {
   return str1.compare(0, str2.length(), str2) == 0;
 }
@@ -251,57 +257,159 @@ bool SearchRegex(const wstring& str, const wstring& pattern) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-size_t LongestCommonSubsequenceLength(const wstring& str1,
-                                      const wstring& str2) {
-  if (str1.empty() || str2.empty())
+// Maps each character of a pattern to the positions where it occurs, without
+// allocating memory. Patterns are limited to 64 characters per word.
+template <size_t Words>
+class PatternMask {
+public:
+  PatternMask(const wchar_t* str, size_t length) {
+    std::fill(&ascii_[0][0], &ascii_[0][0] + 128 * Words, 0);
+    std::fill(std::begin(keys_), std::end(keys_), L'\0');
+    for (size_t i = 0; i < length; ++i) {
+      Insert(str[i])[i / 64] |= 1ULL << (i % 64);
+    }
+  }
+
+  uint64_t Get(wchar_t c, size_t word) const {
+    const auto code = static_cast<unsigned int>(c);
+    if (code < 128)
+      return ascii_[code][word];
+
+    for (size_t i = code % kTableSize; keys_[i] != L'\0';
+         i = (i + 1) % kTableSize) {
+      if (keys_[i] == c)
+        return values_[i][word];
+    }
     return 0;
+  }
+
+private:
+  // Other characters are kept in a small open-addressing table, which can't
+  // be full as it has more slots than the pattern has characters
+  static constexpr size_t kTableSize = 128 * Words;
+
+  uint64_t* Insert(wchar_t c) {
+    const auto code = static_cast<unsigned int>(c);
+    if (code < 128)
+      return ascii_[code];
+
+    size_t i = code % kTableSize;
+    while (keys_[i] != L'\0' && keys_[i] != c)
+      i = (i + 1) % kTableSize;
+    if (keys_[i] == L'\0') {
+      keys_[i] = c;
+      std::fill(values_[i], values_[i] + Words, 0);
+    }
+    return values_[i];
+  }
+
+  uint64_t ascii_[128][Words];
+  wchar_t keys_[kTableSize];
+  uint64_t values_[kTableSize][Words];
+};
+
+// Bit-parallel LCS length (Allison-Dix, Hyyrö). Matched positions of the
+// pattern are cleared from the mask as the text is scanned. The pattern must
+// not be longer than 64 * Words characters.
+template <size_t Words>
+static size_t LcsBitParallel(const wstring& pattern, const wstring& text) {
+  const size_t length = pattern.size();
+  const PatternMask<Words> masks(pattern.data(), length);
+
+  const size_t words = (length + 63) / 64;
+
+  uint64_t v[Words];
+  std::fill(v, v + Words, ~0ULL);
+
+  for (const auto c : text) {
+    uint64_t carry = 0;
+    for (size_t word = 0; word < words; ++word) {
+      const uint64_t u = v[word] & masks.Get(c, word);
+      const uint64_t sum = v[word] + u;
+      const uint64_t x = sum + carry;
+      carry = (sum < u) | (x < sum);
+      v[word] = x | (v[word] - u);
+    }
+  }
+
+  size_t result = 0;
+  for (size_t word = 0; word < words; ++word) {
+    uint64_t matched = ~v[word];
+    if (word == words - 1 && length % 64)
+      matched &= (1ULL << (length % 64)) - 1;
+    for (; matched; matched &= matched - 1)
+      ++result;
+  }
 
-  const size_t len1 = str1.length();
-  const size_t len2 = str2.length();
+  return result;
+}
+
+// Scratch space for the dynamic programming versions, which only need a
+// single row of the table at a time
+static vector<size_t>& GetScratchRow(size_t size) {
+  thread_local vector<size_t> row;
+  row.assign(size, 0);
+  return row;
+}
 
-  vector<vector<size_t>> table(len1 + 1);
-  for (auto it = table.begin(); it != table.end(); ++it)
-    it->resize(len2 + 1);
+static size_t LcsScalar(const wstring& str1, const wstring& str2) {
+  // str2 is the shorter string
+  auto& row = GetScratchRow(str2.size() + 1);
 
-  for (size_t i = 0; i < len1; i++) {
-    for (size_t j = 0; j < len2; j++) {
+  for (size_t i = 0; i < str1.size(); i++) {
+    size_t diagonal = 0;  // table[i][j]
+    for (size_t j = 0; j < str2.size(); j++) {
+      const size_t above = row[j + 1];  // table[i][j + 1]
       if (str1[i] == str2[j]) {
-        table[i + 1][j + 1] = table[i][j] + 1;
+        row[j + 1] = diagonal + 1;
       } else {
-        table[i + 1][j + 1] = std::max(table[i + 1][j], table[i][j + 1]);
+        row[j + 1] = std::max(row[j], above);
       }
+      diagonal = above;
     }
   }
 
-  return table.back().back();
+  return row.back();
 }
 
-size_t LongestCommonSubstringLength(const wstring& str1, const wstring& str2) {
+size_t LongestCommonSubsequenceLength(const wstring& str1,
+                                      const wstring& str2) {
   if (str1.empty() || str2.empty())
     return 0;
 
-  const size_t len1 = str1.length();
-  const size_t len2 = str2.length();
+  // The result is symmetric, so the shorter string is used as the pattern
+  const wstring& pattern = str1.size() <= str2.size() ? str1 : str2;
+  const wstring& text = str1.size() <= str2.size() ? str2 : str1;
+
+  if (pattern.size() <= 64)
+    return LcsBitParallel<1>(pattern, text);
+  if (pattern.size() <= 128)
+    return LcsBitParallel<2>(pattern, text);
 
-  vector<vector<size_t>> table(len1);
-  for (auto it = table.begin(); it != table.end(); ++it)
-    it->resize(len2);
+  return LcsScalar(text, pattern);
+}
 
+size_t LongestCommonSubstringLength(const wstring& str1, const wstring& str2) {
+  if (str1.empty() || str2.empty())
+    return 0;
+
+  // Only the previous row of the table is needed, which is kept for the
+  // shorter string
+  const wstring& shorter = str1.size() <= str2.size() ? str1 : str2;
+  const wstring& longer = str1.size() <= str2.size() ? str2 : str1;
+
+  auto& row = GetScratchRow(shorter.size() + 1);
   size_t longest_length = 0;
 
-  for (size_t i = 0; i < len1; i++) {
-    for (size_t j = 0; j < len2; j++) {
-      if (str1[i] == str2[j]) {
-        if (i == 0 || j == 0) {
-          table[i][j] = 1;
-        } else {
-          table[i][j] = table[i - 1][j - 1] + 1;
-        }
-        if (table[i][j] > longest_length) {
-          longest_length = table[i][j];
-        }
+  for (size_t i = 0; i < longer.size(); i++) {
+    // Iterating backwards allows us to overwrite the row in place
+    for (size_t j = shorter.size(); j > 0; j--) {
+      if (longer[i] == shorter[j - 1]) {
+        row[j] = row[j - 1] + 1;
+        if (row[j] > longest_length)
+          longest_length = row[j];
       } else {
-        table[i][j] = 0;
+        row[j] = 0;
       }
     }
   }
@@ -311,17 +419,132 @@ size_t LongestCommonSubstringLength(const wstring& str1, const wstring& str2) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Hyyrö's bit-parallel formulation of Myers' algorithm, one column at a time.
+// The pattern must not be longer than 64 * Words characters.
+template <size_t Words>
+static size_t LevenshteinBitParallel(const wstring& pattern,
+                                     const wstring& text) {
+  const size_t length = pattern.size();
+  const PatternMask<Words> masks(pattern.data(), length);
+
+  const size_t words = (length + 63) / 64;
+  const uint64_t last = 1ULL << ((length - 1) % 64);
+
+  uint64_t vp[Words];
+  uint64_t vn[Words];
+  std::fill(vp, vp + Words, ~0ULL);
+  std::fill(vn, vn + Words, 0);
+
+  size_t distance = length;
+
+  for (const auto c : text) {
+    // The first row increases by one in each column
+    uint64_t hp_carry = 1;
+    uint64_t hn_carry = 0;
+
+    for (size_t word = 0; word < words; ++word) {
+      const uint64_t x = masks.Get(c, word) | hn_carry;
+      const uint64_t d0 = (((x & vp[word]) + vp[word]) ^ vp[word]) | x | vn[word];
+      uint64_t hp = vn[word] | ~(d0 | vp[word]);
+      uint64_t hn = d0 & vp[word];
+
+      if (word == words - 1) {
+        if (hp & last)
+          ++distance;
+        if (hn & last)
+          --distance;
+      }
+
+      const uint64_t hp_shifted = (hp << 1) | hp_carry;
+      const uint64_t hn_shifted = (hn << 1) | hn_carry;
+      hp_carry = hp >> 63;
+      hn_carry = hn >> 63;
+
+      vp[word] = hn_shifted | ~(d0 | hp_shifted);
+      vn[word] = hp_shifted & d0;
+    }
+  }
+
+  return distance;
+}
+
+static size_t LevenshteinScalar(const wstring& str1, const wstring& str2) {
+  const size_t len1 = str1.size();
+  const size_t len2 = str2.size();
+
+  vector<size_t> prev_col(len2 + 1);
+  for (size_t i = 0; i < prev_col.size(); i++)
+    prev_col[i] = i;
+
+  vector<size_t> col(len2 + 1);
+
+  for (size_t i = 0; i < len1; i++) {
+    col[0] = i + 1;
+
+    for (size_t j = 0; j < len2; j++)
+      col[j + 1] = std::min(std::min(1 + col[j], 1 + prev_col[1 + j]),
+                            prev_col[j] + (str1[i] == str2[j] ? 0 : 1));
+
+    col.swap(prev_col);
+  }
+
+  return prev_col[len2];
+}
+
+// Finds the same matches as the scalar version, which takes the first
+// unmatched character in the window, by isolating the lowest bit of a mask.
+// Both strings must not be longer than 64 characters.
+static void JaroMatchBitParallel(const wstring& str1, const wstring& str2,
+                                 int& m, int& t) {
+  const int len1 = static_cast<int>(str1.size());
+  const int len2 = static_cast<int>(str2.size());
+
+  const PatternMask<1> masks(str1.data(), str1.size());
+
+  uint64_t flags1 = 0;
+  uint64_t flags2 = 0;
+
+  const int range = std::max(0, (std::max(len1, len2) / 2) - 1);
+  for (int i = 0; i < len2; i++) {
+    const int lo = std::max(i - range, 0);
+    const int hi = std::min(i + range + 1, len1);
+    if (lo >= hi)
+      continue;
+    const uint64_t window = (hi == 64 ? ~0ULL : (1ULL << hi) - 1) &
+                            ~((1ULL << lo) - 1);
+    const uint64_t candidates = masks.Get(str2[i], 0) & window & ~flags1;
+    if (candidates) {
+      flags1 |= candidates & (~candidates + 1);
+      flags2 |= 1ULL << i;
+    }
+  }
+
+  m = 0;
+  t = 0;
+
+  // Matched characters are compared in order to count transpositions
+  for (int i = 0, j = 0; i < len2; i++) {
+    if (!(flags2 >> i & 1))
+      continue;
+    while (!(flags1 >> j & 1))
+      j++;
+    if (str2[i] != str1[j])
+      t++;
+    j++;
+    m++;
+  }
+}
+
 // Based on Miguel Serrano's Jaro-Winkler distance implementation
 // Licensed under GNU GPLv3 - Copyright (C) 2011 Miguel Serrano
-double JaroWinklerDistance(const wstring& str1, const wstring& str2) {
+static void JaroMatchScalar(const wstring& str1, const wstring& str2,
+                            int& m, int& t) {
   const int len1 = str1.size();
   const int len2 = str2.size();
 
-  if (!len1 || !len2)
-    return 0.0;
-
   int i, j, l;
-  int m = 0, t = 0;
+  m = 0;
+  t = 0;
   vector<int> sflags(len1), aflags(len2);
 
   // Calculate matching characters
@@ -337,7 +560,7 @@ double JaroWinklerDistance(const wstring& str1, const wstring& str2) {
     }
   }
   if (!m)
-    return 0.0;
+    return;
 
   // Calculate character transpositions
   l = 0;
@@ -353,6 +576,25 @@ double JaroWinklerDistance(const wstring& str1, const wstring& str2) {
         t++;
     }
   }
+}
+
+double JaroWinklerDistance(const wstring& str1, const wstring& str2) {
+  const int len1 = str1.size();
+  const int len2 = str2.size();
+
+  if (!len1 || !len2)
+    return 0.0;
+
+  int i, l;
+  int m = 0, t = 0;
+
+  if (len1 <= 64 && len2 <= 64) {
+    JaroMatchBitParallel(str1, str2, m, t);
+  } else {
+    JaroMatchScalar(str1, str2, m, t);
+  }
+  if (!m)
+    return 0.0;
   t /= 2;
 
   // Jaro distance
@@ -374,64 +616,111 @@ double JaroWinklerDistance(const wstring& str1, const wstring& str2) {
 }
 
 double LevenshteinDistance(const wstring& str1, const wstring& str2) {
-  const size_t len1 = str1.size();
-  const size_t len2 = str2.size();
+  // The distance is symmetric, so the shorter string is used as the pattern
+  const wstring& pattern = str1.size() <= str2.size() ? str1 : str2;
+  const wstring& text = str1.size() <= str2.size() ? str2 : str1;
+
+  size_t distance = 0;
+  if (pattern.empty()) {
+    distance = text.size();
+  } else if (pattern.size() <= 64) {
+    distance = LevenshteinBitParallel<1>(pattern, text);
+  } else if (pattern.size() <= 128) {
+    distance = LevenshteinBitParallel<2>(pattern, text);
+  } else {
+    distance = LevenshteinScalar(str1, str2);
+  }
 
-  vector<size_t> prev_col(len2 + 1);
-  for (size_t i = 0; i < prev_col.size(); i++)
-    prev_col[i] = i;
+  const double len = static_cast<double>(std::max(str1.size(), str2.size()));
+  return 1.0 - (distance / len);
+}
 
-  vector<size_t> col(len2 + 1);
+////////////////////////////////////////////////////////////////////////////////
 
-  for (size_t i = 0; i < len1; i++) {
-    col[0] = i + 1;
+// wchar_t is a UTF-16 code unit, so three of them fit into 48 bits
+static_assert(sizeof(wchar_t) == 2, "Trigrams require 16-bit characters");
 
-    for (size_t j = 0; j < len2; j++)
-      col[j + 1] = std::min(std::min(1 + col[j], 1 + prev_col[1 + j]),
-                            prev_col[j] + (str1[i] == str2[j] ? 0 : 1));
+constexpr trigram_t kTrigramCountMask = 0xFFFF;
 
-    col.swap(prev_col);
+static trigram_t PackTrigram(const wchar_t* str, size_t length) {
+  trigram_t trigram = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    const trigram_t c = i < length ? static_cast<uint16_t>(str[i]) : 0;
+    trigram = (trigram << 16) | c;
   }
-
-  const double len = static_cast<double>(std::max(str1.size(), str2.size()));
-  return 1.0 - (prev_col[len2] / len);
+  return trigram << 16;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
 void GetTrigrams(const wstring& str, trigram_container_t& output) {
   const size_t n = 3;
 
-  if (n < 1)
-    return;
-
   output.clear();
 
   if (n >= str.size()) {
-    trigram_t buffer = {'\0'};
-    std::copy(str.begin(), str.end(), buffer.begin());
-    output.push_back(buffer);
+    output.push_back(PackTrigram(str.data(), str.size()) | 1);
     return;
   }
 
   for (size_t i = 0; i <= str.size() - n; ++i) {
-    trigram_t buffer = {'\0'};
-    std::copy(str.begin() + i, str.begin() + (i + n), buffer.begin());
-    output.push_back(buffer);
+    output.push_back(PackTrigram(str.data() + i, n));
   }
 
   std::sort(output.begin(), output.end());
+
+  // Duplicates are adjacent, so we can count them while removing them
+  size_t size = 0;
+  for (size_t i = 0; i < output.size(); ++i) {
+    if (size > 0 && GetTrigramKey(output[size - 1]) == output[i]) {
+      if ((output[size - 1] & kTrigramCountMask) < kTrigramCountMask)
+        ++output[size - 1];
+    } else {
+      output[size++] = output[i] | 1;
+    }
+  }
+  output.resize(size);
+}
+
+trigram_t GetTrigramKey(trigram_t trigram) {
+  return trigram & ~kTrigramCountMask;
 }
 
 double CompareTrigrams(const trigram_container_t& t1,
                        const trigram_container_t& t2) {
-  trigram_container_t intersection;
-
-  std::set_intersection(t1.begin(), t1.end(), t2.begin(), t2.end(),
-                        std::back_inserter(intersection));
+  // Both containers are sorted, so the intersection is found by merging them.
+  // Repeated trigrams are counted as many times as they occur in both strings.
+  size_t size1 = 0;
+  size_t size2 = 0;
+  size_t intersection = 0;
+
+  auto it1 = t1.begin();
+  auto it2 = t2.begin();
+
+  while (it1 != t1.end() && it2 != t2.end()) {
+    const auto key1 = GetTrigramKey(*it1);
+    const auto key2 = GetTrigramKey(*it2);
+    const auto count1 = static_cast<size_t>(*it1 & kTrigramCountMask);
+    const auto count2 = static_cast<size_t>(*it2 & kTrigramCountMask);
+    if (key1 < key2) {
+      size1 += count1;
+      ++it1;
+    } else if (key2 < key1) {
+      size2 += count2;
+      ++it2;
+    } else {
+      size1 += count1;
+      size2 += count2;
+      intersection += std::min(count1, count2);
+      ++it1;
+      ++it2;
+    }
+  }
+  for (; it1 != t1.end(); ++it1)
+    size1 += static_cast<size_t>(*it1 & kTrigramCountMask);
+  for (; it2 != t2.end(); ++it2)
+    size2 += static_cast<size_t>(*it2 & kTrigramCountMask);
 
-  return static_cast<double>(intersection.size()) /
-         static_cast<double>(std::max(t1.size(), t2.size()));
+  return static_cast<double>(intersection) /
+         static_cast<double>(std::max(size1, size2));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
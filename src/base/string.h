@@ -18,7 +18,7 @@
 
 #pragma once
 
-#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <windows.h>
@@ -50,6 +50,7 @@ bool IsNumericChar(const wchar_t c);
 bool IsNumericString(const std::wstring& str);
 bool IsWhitespace(const wchar_t c);
 
+bool StartsWith(const std::string& str, const std::string& search);
 bool StartsWith(const std::wstring& str, const std::wstring& search);
 bool EndsWith(const std::wstring& str, const std::wstring& search);
 bool IntersectsWith(const std::wstring& str1, const std::wstring& str2);
@@ -62,9 +63,12 @@ size_t LongestCommonSubstringLength(const std::wstring& str1, const std::wstring
 double JaroWinklerDistance(const std::wstring& str1, const std::wstring& str2);
 double LevenshteinDistance(const std::wstring& str1, const std::wstring& str2);
 
-typedef std::array<wchar_t, 3> trigram_t;
+// Each trigram is packed into the upper 48 bits, while the lower 16 bits hold
+// the number of times it occurs in the string.
+typedef uint64_t trigram_t;
 typedef std::vector<trigram_t> trigram_container_t;
 void GetTrigrams(const std::wstring& str, trigram_container_t& output);
+trigram_t GetTrigramKey(trigram_t trigram);
 double CompareTrigrams(const trigram_container_t& t1, const trigram_container_t& t2);
 
 void ReplaceChar(std::wstring& str, const wchar_t c, const wchar_t replace_with);
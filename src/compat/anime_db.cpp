@@ -107,6 +107,7 @@ void Database::ReadDatabaseInCompatibilityMode(xml_document& document) {
     Item& item = items[ToInt(id)];  // Creates the item if it doesn't exist
     item.SetId(id, sync::kTaiga);
     item.SetId(id, sync::kMyAnimeList);
+    AddToIdIndex(item);
     item.SetTitle(XmlReadStrValue(node, L"series_title"));
     item.SetEnglishTitle(XmlReadStrValue(node, L"series_english"));
     item.SetSynonyms(XmlReadStrValue(node, L"series_synonyms"));
@@ -17,6 +17,7 @@
 */
 
 #include <algorithm>
+#include <tuple>
 
 #include "base/file.h"
 #include "base/log.h"
@@ -32,6 +33,7 @@
 #include "taiga/http.h"
 #include "taiga/path.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "taiga/taiga.h"
 #include "track/recognition.h"
 #include "ui/dlg/dlg_anime_list.h"
@@ -42,8 +44,22 @@ anime::Database AnimeDatabase;
 namespace anime {
 
 bool Database::LoadDatabase() {
+  return LoadDatabase(taiga::GetPath(taiga::Path::DatabaseAnime), true);
+}
+
+bool Database::LoadDatabase(const std::wstring& path, bool use_snapshot) {
+  // Other databases (e.g. for benchmarks) must not affect the current session
+  if (this == &AnimeDatabase) {
+    Stats.InvalidateItems();
+    Meow.InvalidateCache();
+  }
+
+  // Reading the binary snapshot is much faster than parsing the XML document,
+  // but we can only use it if it's up to date
+  if (use_snapshot && LoadSnapshot(path))
+    return true;
+
   xml_document document;
-  std::wstring path = taiga::GetPath(taiga::Path::DatabaseAnime);
   unsigned int options = pugi::parse_default & ~pugi::parse_eol;
   xml_parse_result parse_result = document.load_file(path.c_str(), options);
 
@@ -105,6 +121,7 @@ void Database::ReadDatabaseNode(xml_node& database_node) {
 
     for (const auto& pair : id_map)
       item.SetId(pair.second, pair.first);
+    AddToIdIndex(item);
 
     item.SetSource(source);
     item.SetTitle(XmlReadStrValue(node, L"title"));
@@ -115,24 +132,28 @@ void Database::ReadDatabaseNode(xml_node& database_node) {
     item.SetProducers(XmlReadStrValue(node, L"producers"));
     item.SetSynopsis(XmlReadStrValue(node, L"synopsis"));
     item.SetLastModified(ToTime(XmlReadStrValue(node, L"modified")));
+    item.SetPopularity(XmlReadIntValue(node, L"popularity"));
+    item.SetScore(ToDouble(XmlReadStrValue(node, L"score")));
+    item.SetDateStart(Date(XmlReadStrValue(node, L"date_start")));
+    item.SetDateEnd(Date(XmlReadStrValue(node, L"date_end")));
+    item.SetEpisodeCount(XmlReadIntValue(node, L"episode_count"));
+    item.SetEpisodeLength(XmlReadIntValue(node, L"episode_length"));
 
     // This ordering results in less reallocations
     item.SetEnglishTitle(XmlReadStrValue(node, L"english"));  // alternative
     item.SetJapaneseTitle(XmlReadStrValue(node, L"japanese"));  // alternative
     foreach_xmlnode_(child_node, node, L"synonym")
       item.InsertSynonym(child_node.child_value());  // alternative
-    item.SetPopularity(XmlReadIntValue(node, L"popularity"));  // community(1)
-    item.SetScore(ToDouble(XmlReadStrValue(node, L"score")));  // community(0)
-    item.SetDateEnd(Date(XmlReadStrValue(node, L"date_end")));      // date(1)
-    item.SetDateStart(Date(XmlReadStrValue(node, L"date_start")));  // date(0)
-    item.SetEpisodeLength(XmlReadIntValue(node, L"episode_length"));  // extent(1)
-    item.SetEpisodeCount(XmlReadIntValue(node, L"episode_count"));    // extent(0)
     item.SetSlug(XmlReadStrValue(node, L"slug"));       // resource(1)
     item.SetImageUrl(XmlReadStrValue(node, L"image"));  // resource(0)
   }
 }
 
 bool Database::SaveDatabase() {
+  return SaveDatabase(taiga::GetPath(taiga::Path::DatabaseAnime));
+}
+
+bool Database::SaveDatabase(const std::wstring& path) {
   xml_document document;
 
   xml_node meta_node = document.append_child(L"meta");
@@ -141,8 +162,13 @@ bool Database::SaveDatabase() {
   xml_node database_node = document.append_child(L"database");
   WriteDatabaseNode(database_node);
 
-  std::wstring path = taiga::GetPath(taiga::Path::DatabaseAnime);
-  return XmlWriteDocumentToFile(document, path);
+  if (!XmlWriteDocumentToFile(document, path))
+    return false;
+
+  if (!SaveSnapshot(path))
+    LOGW(L"Could not save database snapshot for: {}", path);
+
+  return true;
 }
 
 void Database::WriteDatabaseNode(xml_node& database_node) {
@@ -217,9 +243,15 @@ Item* Database::FindItem(int id, bool log_error) {
 Item* Database::FindItem(const std::wstring& id, enum_t service,
                          bool log_error) {
   if (!id.empty()) {
-    for (auto& pair : items)
-      if (id == pair.second.GetId(service))
-        return &pair.second;
+    auto index = id_index_.find(service);
+    if (index != id_index_.end()) {
+      auto it = index->second.find(id);
+      if (it != index->second.end()) {
+        auto item = FindItem(it->second, false);
+        if (item && item->GetId(service) == id)
+          return item;
+      }
+    }
     if (log_error)
       LOGE(L"Could not find ID: {}", id);
   }
@@ -227,13 +259,38 @@ Item* Database::FindItem(const std::wstring& id, enum_t service,
   return nullptr;
 }
 
+void Database::AddToIdIndex(const Item& item) {
+  const int anime_id = item.GetId();
+
+  for (enum_t i = sync::kTaiga; i <= sync::kLastService; i++) {
+    const auto& id = item.GetId(i);
+    if (!id.empty())
+      id_index_[i][id] = anime_id;
+  }
+}
+
+void Database::RemoveFromIdIndex(const Item& item) {
+  const int anime_id = item.GetId();
+
+  for (enum_t i = sync::kTaiga; i <= sync::kLastService; i++) {
+    auto& index = id_index_[i];
+    auto it = index.find(item.GetId(i));
+    if (it != index.end() && it->second == anime_id)
+      index.erase(it);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void Database::ClearInvalidItems() {
+  Stats.InvalidateItems();
+  Meow.InvalidateCache();
+
   for (auto it = items.begin(); it != items.end(); ) {
     if (!anime::IsValidId(it->second.GetId()) ||
         it->first != it->second.GetId()) {
       LOGD(L"ID: {}", it->first);
+      RemoveFromIdIndex(it->second);
       items.erase(it++);
     } else {
       ++it;
@@ -245,8 +302,10 @@ bool Database::DeleteItem(int id) {
   std::wstring title;
 
   auto anime_item = FindItem(id, false);
-  if (anime_item)
+  if (anime_item) {
     title = anime::GetPreferredTitle(*anime_item);
+    RemoveFromIdIndex(*anime_item);
+  }
 
   if (items.erase(id) > 0) {
     LOGW(L"ID: {} | Title: {}", id, title);
@@ -260,6 +319,9 @@ bool Database::DeleteItem(int id) {
 
     delete_history_items(id, History.items);
     delete_history_items(id, History.queue.items);
+    History.queue.RebuildIndex();
+    Stats.InvalidateItem(id);
+    Meow.InvalidateCache();
 
     auto& items = SeasonDatabase.items;
     items.erase(std::remove(items.begin(), items.end(), id), items.end());
@@ -296,6 +358,7 @@ int Database::UpdateItem(const Item& new_item) {
     // Add a new item
     item = &items[id];
     item->SetId(ToWstr(id), sync::kTaiga);
+    AddToIdIndex(*item);
   }
 
   // Update series information if new information is, well, new.
@@ -303,9 +366,24 @@ int Database::UpdateItem(const Item& new_item) {
       new_item.GetLastModified() >= item->GetLastModified()) {
     item->SetLastModified(new_item.GetLastModified());
 
+    // Fields that recognition reads, to compare against after the update
+    const auto get_titles = [&item]() {
+      return std::make_tuple(item->GetTitle(), item->GetEnglishTitle(false),
+                             item->GetJapaneseTitle(), item->GetSynonyms());
+    };
+    const auto get_details = [&item]() {
+      return std::make_tuple(item->GetType(), item->GetEpisodeCount(),
+                             item->GetDateStart(), item->GetDateEnd(),
+                             item->GetAiringStatus(false));
+    };
+    const auto previous_titles = get_titles();
+    const auto previous_details = get_details();
+
+    RemoveFromIdIndex(*item);
     for (enum_t i = sync::kFirstService; i <= sync::kLastService; i++)
       if (!new_item.GetId(i).empty())
         item->SetId(new_item.GetId(i), i);
+    AddToIdIndex(*item);
 
     if (new_item.GetSource() != sync::kTaiga)
       item->SetSource(new_item.GetSource());
@@ -336,23 +414,23 @@ int Database::UpdateItem(const Item& new_item) {
       item->SetImageUrl(new_item.GetImageUrl());
     if (new_item.GetAgeRating() != kUnknownAgeRating)
       item->SetAgeRating(new_item.GetAgeRating());
-    if (!new_item.GetGenres().empty())
+    if (!new_item.GetGenreIds().empty())
       item->SetGenres(new_item.GetGenres());
     if (new_item.GetPopularity() > 0)
       item->SetPopularity(new_item.GetPopularity());
-    if (!new_item.GetProducers().empty())
+    if (!new_item.GetProducerIds().empty())
       item->SetProducers(new_item.GetProducers());
     if (new_item.GetScore() != kUnknownScore)
       item->SetScore(new_item.GetScore());
     if (!new_item.GetSynopsis().empty())
       item->SetSynopsis(new_item.GetSynopsis());
 
-    // Update clean titles, if necessary
-    if (!new_item.GetTitle().empty() ||
-        !new_item.GetSynonyms().empty() ||
-        !new_item.GetEnglishTitle(false).empty() ||
-        !new_item.GetJapaneseTitle().empty())
+    // Update clean titles and invalidate recognition results, if necessary
+    if (get_titles() != previous_titles) {
       Meow.UpdateTitles(*item);
+    } else if (get_details() != previous_details) {
+      Meow.InvalidateCache();
+    }
   }
 
   // Update user information
@@ -388,6 +466,8 @@ int Database::UpdateItem(const Item& new_item) {
       item->SetNextEpisodeTime(new_item.GetNextEpisodeTime());
   }
 
+  Stats.InvalidateItem(item->GetId());
+
   return item->GetId();
 }
 
@@ -548,6 +628,7 @@ void Database::AddToList(int anime_id, int status) {
                                               anime::kPlanToWatch;
 
   anime_item->AddtoUserList();
+  Stats.InvalidateItem(anime_id);
 
   HistoryItem history_item;
   history_item.anime_id = anime_id;
@@ -573,6 +654,9 @@ void Database::AddToList(int anime_id, int status) {
 void Database::ClearUserData() {
   for (auto& pair : items)
     pair.second.RemoveFromUserList();
+
+  Stats.InvalidateItems();
+  Meow.InvalidateCache();
 }
 
 bool Database::DeleteListItem(int anime_id) {
@@ -584,6 +668,7 @@ bool Database::DeleteListItem(int anime_id) {
     return false;
 
   anime_item->RemoveFromUserList();
+  Stats.InvalidateItem(anime_id);
 
   ui::ChangeStatusText(L"Item deleted. (" + anime::GetPreferredTitle(*anime_item) + L")");
   ui::OnLibraryEntryDelete(anime_item->GetId());
@@ -601,6 +686,7 @@ void Database::UpdateItem(const HistoryItem& history_item) {
     return;
 
   anime_item->AddtoUserList();
+  Stats.InvalidateItem(anime_item->GetId());
 
   // Edit episode
   if (history_item.episode) {
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 
 #include "library/anime_item.h"
 
@@ -33,7 +34,9 @@ namespace anime {
 class Database {
 public:
   bool LoadDatabase();
+  bool LoadDatabase(const std::wstring& path, bool use_snapshot);
   bool SaveDatabase();
+  bool SaveDatabase(const std::wstring& path);
 
   Item* FindItem(int id, bool log_error = true);
   Item* FindItem(const std::wstring& id, enum_t service, bool log_error = true);
@@ -57,6 +60,12 @@ public:
   std::map<int, Item> items;
 
 private:
+  void AddToIdIndex(const Item& item);
+  void RemoveFromIdIndex(const Item& item);
+
+  bool LoadSnapshot(const std::wstring& source_path);
+  bool SaveSnapshot(const std::wstring& source_path) const;
+
   void ReadDatabaseNode(pugi::xml_node& database_node);
   void WriteDatabaseNode(pugi::xml_node& database_node);
 
@@ -65,6 +74,9 @@ private:
   void HandleListCompatibility(const std::wstring& meta_version);
   void ReadDatabaseInCompatibilityMode(pugi::xml_document& document);
   void ReadListInCompatibilityMode(pugi::xml_document& document);
+
+  // Maps service IDs to anime IDs, for each service
+  std::map<enum_t, std::unordered_map<std::wstring, int>> id_index_;
 };
 
 }  // namespace anime
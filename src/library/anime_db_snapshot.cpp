@@ -0,0 +1,387 @@
+/*
+** Taiga
+** Copyright (C) 2010-2018, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "base/file.h"
+#include "base/log.h"
+#include "base/string.h"
+#include "base/time.h"
+#include "library/anime_db.h"
+#include "sync/service.h"
+#include "taiga/settings.h"
+#include "taiga/taiga.h"
+
+// The snapshot is a binary copy of db\anime.xml, which is written next to it
+// each time the database is saved. Its layout is as follows:
+//
+// - Header
+// - String offsets: uint32_t[string_count + 1], in characters
+// - String data: wchar_t[string_data_size], not null-terminated
+// - String lists: uint32_t[list_count], indices to the string table
+// - ID columns: uint32_t[service_count][record_count], indices to the string
+//   table, one column per service
+// - Records: Record[record_count]
+//
+// Each section begins at an 8-byte boundary. The snapshot is considered stale
+// if the size or the modification time of the XML file doesn't match the
+// values in its header, or if it was written by another version of Taiga.
+
+namespace anime {
+
+namespace snapshot {
+
+constexpr char kMagic[4] = {'T', 'A', 'D', 'B'};
+constexpr uint32_t kFormatVersion = 2;
+
+struct Header {
+  char magic[4];
+  uint32_t format_version;
+  uint64_t source_size;
+  uint64_t source_time;
+  uint32_t taiga_version;
+  uint32_t service_count;
+  uint32_t string_count;
+  uint32_t list_count;
+  uint32_t record_count;
+  uint32_t string_data_size;  // in characters
+  uint64_t string_offsets;
+  uint64_t string_data;
+  uint64_t lists;
+  uint64_t id_columns;
+  uint64_t records;
+};
+
+struct List {
+  uint32_t first;
+  uint32_t count;
+};
+
+struct Record {
+  double score;
+  int64_t modified;
+  uint32_t source;
+  int32_t type;
+  int32_t status;
+  uint32_t age_rating;
+  int32_t episode_count;
+  int32_t episode_length;
+  int32_t popularity;
+  uint32_t date_start;
+  uint32_t date_end;
+  uint32_t title;
+  uint32_t english_title;
+  uint32_t japanese_title;
+  uint32_t slug;
+  uint32_t image_url;
+  uint32_t synopsis;
+  List synonyms;
+  List genres;
+  List producers;
+};
+
+static_assert(sizeof(wchar_t) == 2, "Snapshot strings are UTF-16");
+
+static std::wstring GetPath(const std::wstring& source_path) {
+  return GetFileWithoutExtension(source_path) + L".bin";
+}
+
+static uint32_t PackDate(const Date& date) {
+  return (date.year() << 16) | (date.month() << 8) | date.day();
+}
+
+static Date UnpackDate(uint32_t value) {
+  return Date(static_cast<unsigned short>(value >> 16),
+              static_cast<unsigned short>((value >> 8) & 0xFF),
+              static_cast<unsigned short>(value & 0xFF));
+}
+
+static std::wstring GetTaigaVersion() {
+  return StrToWstr(Taiga.version.to_string());
+}
+
+}  // namespace snapshot
+
+bool Database::LoadSnapshot(const std::wstring& source_path) {
+  using namespace snapshot;
+
+  const auto path = snapshot::GetPath(source_path);
+
+  FileMapping file;
+  if (!file.Open(path))
+    return false;
+
+  const BYTE* data = file.data();
+  const size_t size = file.size();
+
+  Header header;
+  if (size < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.format_version != kFormatVersion ||
+      header.service_count != sync::kLastService + 1) {
+    LOGW(L"Invalid snapshot: {}", path);
+    return false;
+  }
+
+  if (header.source_size != GetFileSize(source_path) ||
+      header.source_time != GetFileLastWriteTime(source_path)) {
+    LOGD(L"Snapshot is out of date: {}", path);
+    return false;
+  }
+
+  auto is_valid_section = [&size](uint64_t offset, uint64_t count,
+                                  uint64_t element_size) {
+    return offset <= size && count <= (size - offset) / element_size;
+  };
+
+  if (!is_valid_section(header.string_offsets, header.string_count + 1ull,
+                        sizeof(uint32_t)) ||
+      !is_valid_section(header.string_data, header.string_data_size,
+                        sizeof(wchar_t)) ||
+      !is_valid_section(header.lists, header.list_count, sizeof(uint32_t)) ||
+      !is_valid_section(header.id_columns,
+                        static_cast<uint64_t>(header.service_count) *
+                            header.record_count,
+                        sizeof(uint32_t)) ||
+      !is_valid_section(header.records, header.record_count,
+                        sizeof(Record))) {
+    LOGW(L"Invalid snapshot: {}", path);
+    return false;
+  }
+
+  const auto string_offsets =
+      reinterpret_cast<const uint32_t*>(data + header.string_offsets);
+  const auto string_data =
+      reinterpret_cast<const wchar_t*>(data + header.string_data);
+  const auto lists = reinterpret_cast<const uint32_t*>(data + header.lists);
+  const auto id_columns =
+      reinterpret_cast<const uint32_t*>(data + header.id_columns);
+
+  auto get_string = [&](uint32_t index) {
+    if (index >= header.string_count)
+      return std::wstring();
+    const auto begin = string_offsets[index];
+    const auto end = string_offsets[index + 1];
+    if (begin > end || end > header.string_data_size)
+      return std::wstring();
+    return std::wstring(string_data + begin, end - begin);
+  };
+
+  auto get_list = [&](const List& list) {
+    std::vector<std::wstring> output;
+    if (list.first <= header.list_count &&
+        list.count <= header.list_count - list.first) {
+      output.reserve(list.count);
+      for (uint32_t i = list.first; i < list.first + list.count; ++i) {
+        output.push_back(get_string(lists[i]));
+      }
+    }
+    return output;
+  };
+
+  // This is also the meta version of the XML file, which is written at the
+  // same time
+  const auto meta_version = get_string(header.taiga_version);
+  if (meta_version != GetTaigaVersion()) {
+    LOGD(L"Snapshot was written by another version: {}", path);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < header.record_count; ++i) {
+    Record record;
+    std::memcpy(&record, data + header.records + i * sizeof(Record),
+                sizeof(Record));
+
+    std::map<enum_t, std::wstring> id_map;
+    for (uint32_t service = 0; service < header.service_count; ++service) {
+      auto id = get_string(id_columns[service * header.record_count + i]);
+      if (!id.empty())
+        id_map[service] = id;
+    }
+
+    enum_t source = record.source;
+    if (source == sync::kTaiga) {
+      auto current_service_id = taiga::GetCurrentServiceId();
+      if (id_map.find(current_service_id) != id_map.end()) {
+        source = current_service_id;
+        LOGW(L"Fixed source for ID: {}", id_map[source]);
+      } else {
+        LOGE(L"Invalid source for ID: {}", id_map[sync::kTaiga]);
+        continue;
+      }
+    }
+
+    int id = ToInt(id_map[sync::kTaiga]);
+    Item& item = items[id];  // Creates the item if it doesn't exist
+
+    for (const auto& pair : id_map)
+      item.SetId(pair.second, pair.first);
+    AddToIdIndex(item);
+
+    item.SetSource(source);
+    item.SetTitle(get_string(record.title));
+    item.SetType(record.type);
+    item.SetAiringStatus(record.status);
+    item.SetAgeRating(record.age_rating);
+    item.SetGenres(get_list(record.genres));
+    item.SetProducers(get_list(record.producers));
+    item.SetSynopsis(get_string(record.synopsis));
+    item.SetLastModified(static_cast<time_t>(record.modified));
+
+    // Same ordering as in ReadDatabaseNode
+    item.SetEnglishTitle(get_string(record.english_title));
+    item.SetJapaneseTitle(get_string(record.japanese_title));
+    for (const auto& synonym : get_list(record.synonyms))
+      item.InsertSynonym(synonym);
+    item.SetPopularity(record.popularity);
+    item.SetScore(record.score);
+    item.SetDateEnd(UnpackDate(record.date_end));
+    item.SetDateStart(UnpackDate(record.date_start));
+    item.SetEpisodeLength(record.episode_length);
+    item.SetEpisodeCount(record.episode_count);
+    item.SetSlug(get_string(record.slug));
+    item.SetImageUrl(get_string(record.image_url));
+  }
+
+  // Same as when reading the XML file
+  HandleCompatibility(meta_version);
+
+  LOGD(L"Loaded {} items from snapshot: {}", header.record_count, path);
+
+  return true;
+}
+
+bool Database::SaveSnapshot(const std::wstring& source_path) const {
+  using namespace snapshot;
+
+  std::unordered_map<std::wstring, uint32_t> string_indices;
+  std::vector<uint32_t> string_offsets{0};
+  std::wstring string_data;
+  std::vector<uint32_t> lists;
+
+  auto add_string = [&](const std::wstring& str) {
+    auto it = string_indices.find(str);
+    if (it != string_indices.end())
+      return it->second;
+    const auto index = static_cast<uint32_t>(string_offsets.size() - 1);
+    string_data.append(str);
+    string_offsets.push_back(static_cast<uint32_t>(string_data.size()));
+    string_indices.emplace(str, index);
+    return index;
+  };
+
+  auto add_list = [&](const std::vector<std::wstring>& strings) {
+    List list{static_cast<uint32_t>(lists.size()),
+              static_cast<uint32_t>(strings.size())};
+    for (const auto& str : strings) {
+      lists.push_back(add_string(str));
+    }
+    return list;
+  };
+
+  const size_t service_count = sync::kLastService + 1;
+  std::vector<uint32_t> id_columns(service_count * items.size());
+  std::vector<Record> records;
+  records.reserve(items.size());
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.format_version = kFormatVersion;
+  header.taiga_version = add_string(GetTaigaVersion());
+  header.service_count = static_cast<uint32_t>(service_count);
+  header.record_count = static_cast<uint32_t>(items.size());
+
+  for (const auto& pair : items) {
+    const auto& item = pair.second;
+    const size_t i = records.size();
+
+    for (size_t service = 0; service < service_count; ++service) {
+      id_columns.at(service * items.size() + i) =
+          add_string(item.GetId(static_cast<enum_t>(service)));
+    }
+
+    // Values are stored the way WriteDatabaseNode would store them, so that
+    // both formats are read back into identical items
+    auto positive = [](int value) { return std::max(value, 0); };
+    auto valid_date = [](const Date& date) { return date ? PackDate(date) : 0; };
+
+    Record record{};
+    record.score = std::max(item.GetScore(), 0.0);
+    record.modified = static_cast<int64_t>(item.GetLastModified());
+    record.source = item.GetSource();
+    record.type = positive(item.GetType());
+    record.status = positive(item.GetAiringStatus());
+    record.age_rating = positive(item.GetAgeRating());
+    record.episode_count = positive(item.GetEpisodeCount());
+    record.episode_length = positive(item.GetEpisodeLength());
+    record.popularity = positive(item.GetPopularity());
+    record.date_start = valid_date(item.GetDateStart());
+    record.date_end = valid_date(item.GetDateEnd());
+    record.title = add_string(item.GetTitle());
+    record.english_title = add_string(item.GetEnglishTitle());
+    record.japanese_title = add_string(item.GetJapaneseTitle());
+    record.slug = add_string(item.GetSlug());
+    record.image_url = add_string(item.GetImageUrl());
+    record.synopsis = add_string(item.GetSynopsis());
+    record.synonyms = add_list(item.GetSynonyms());
+    record.genres = add_list(item.GetGenres());
+    record.producers = add_list(item.GetProducers());
+    records.push_back(record);
+  }
+
+  header.string_count = static_cast<uint32_t>(string_offsets.size() - 1);
+  header.list_count = static_cast<uint32_t>(lists.size());
+  header.string_data_size = static_cast<uint32_t>(string_data.size());
+
+  std::string buffer(sizeof(header), '\0');
+
+  auto append = [&buffer](const void* data, size_t size) {
+    buffer.resize((buffer.size() + 7) & ~static_cast<size_t>(7), '\0');
+    const auto offset = static_cast<uint64_t>(buffer.size());
+    if (size)
+      buffer.append(static_cast<const char*>(data), size);
+    return offset;
+  };
+
+  header.string_offsets = append(string_offsets.data(),
+                                 string_offsets.size() * sizeof(uint32_t));
+  header.string_data = append(string_data.data(),
+                              string_data.size() * sizeof(wchar_t));
+  header.lists = append(lists.data(), lists.size() * sizeof(uint32_t));
+  header.id_columns = append(id_columns.data(),
+                             id_columns.size() * sizeof(uint32_t));
+  header.records = append(records.data(), records.size() * sizeof(Record));
+
+  // The snapshot belongs to the XML file as it is now on disk
+  header.source_size = GetFileSize(source_path);
+  header.source_time = GetFileLastWriteTime(source_path);
+  if (!header.source_size || !header.source_time)
+    return false;
+
+  std::memcpy(&buffer.front(), &header, sizeof(header));
+
+  return SaveToFile(buffer, snapshot::GetPath(source_path));
+}
+
+}  // namespace anime
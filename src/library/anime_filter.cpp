@@ -24,6 +24,7 @@
 #include "library/anime_filter.h"
 #include "library/anime_item.h"
 #include "library/anime_util.h"
+#include "library/metadata.h"
 
 namespace anime {
 
@@ -53,6 +54,7 @@ struct SearchTerm {
   SearchField field = SearchField::None;
   SearchOperator op = SearchOperator::EQ;
   std::wstring value;
+  std::vector<library::string_id_t> string_ids;
 };
 
 SearchTerm GetSearchTerm(const std::wstring& str) {
@@ -124,6 +126,49 @@ bool CheckStrings(const std::vector<std::wstring>& v, const std::wstring& w) {
   return false;
 };
 
+bool CheckStringIds(const std::vector<library::string_id_t>& v,
+                    const std::vector<library::string_id_t>& ids) {
+  for (const auto& id : v) {
+    if (std::binary_search(ids.begin(), ids.end(), id))
+      return true;
+  }
+  return false;
+}
+
+// Filters are checked against every item in a list, so the terms are parsed
+// once. Genres and producers that match a term are found in advance, which
+// leaves only a lookup for each item. New values might match as well, so the
+// terms are parsed again when the string pool grows.
+const std::vector<SearchTerm>& GetSearchTerms(const std::wstring& text) {
+  thread_local std::wstring cached_text;
+  thread_local size_t cached_pool_size = 0;
+  thread_local std::vector<SearchTerm> search_terms;
+
+  const size_t pool_size = MetadataStrings.GetSize();
+  if (text == cached_text && pool_size == cached_pool_size)
+    return search_terms;
+
+  cached_text = text;
+  cached_pool_size = pool_size;
+  search_terms.clear();
+
+  std::vector<std::wstring> words;
+  Split(text, L" ", words);
+  RemoveEmptyStrings(words);
+
+  for (const auto& word : words) {
+    auto term = GetSearchTerm(word);
+    if (term.field == SearchField::None ||
+        term.field == SearchField::Genre ||
+        term.field == SearchField::Producer) {
+      MetadataStrings.Find(term.value, term.string_ids);
+    }
+    search_terms.push_back(term);
+  }
+
+  return search_terms;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Filters::CheckItem(const Item& item, int text_index) const {
@@ -132,28 +177,21 @@ bool Filters::CheckItem(const Item& item, int text_index) const {
   if (it == text.end() || it->second.empty())
     return true;
 
-  std::vector<std::wstring> words;
-  Split(it->second, L" ", words);
-  RemoveEmptyStrings(words);
+  const auto& search_terms = GetSearchTerms(it->second);
 
   std::vector<std::wstring> titles;
   GetAllTitles(item.GetId(), titles);
 
-  const auto& genres = item.GetGenres();
-  const auto& producers = item.GetProducers();
+  const auto& genres = item.GetGenreIds();
+  const auto& producers = item.GetProducerIds();
   const auto& tags = item.GetMyTags();
   const auto& notes = item.GetMyNotes();
 
-  std::vector<SearchTerm> search_terms;
-  for (const auto& word : words) {
-    search_terms.push_back(GetSearchTerm(word));
-  }
-
   for (const auto& term : search_terms) {
     switch (term.field) {
       case SearchField::None:
         if (!CheckStrings(titles, term.value) &&
-            !CheckStrings(genres, term.value) &&
+            !CheckStringIds(genres, term.string_ids) &&
             !CheckString(tags, term.value) &&
             !CheckString(notes, term.value)) {
           return false;
@@ -176,12 +214,12 @@ bool Filters::CheckItem(const Item& item, int text_index) const {
         break;
 
       case SearchField::Genre:
-        if (!CheckStrings(genres, term.value))
+        if (!CheckStringIds(genres, term.string_ids))
           return false;
         break;
 
       case SearchField::Producer:
-        if (!CheckStrings(producers, term.value))
+        if (!CheckStringIds(producers, term.string_ids))
           return false;
         break;
 
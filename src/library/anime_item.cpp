@@ -28,12 +28,12 @@
 #include "sync/sync.h"
 #include "ui/ui.h"
 
-anime::Database* anime::Item::database_ = &AnimeDatabase;
-
 namespace anime {
 
 Item::Item() {
   metadata_.uid.resize(sync::kLastService + 1);
+  metadata_.episode_count = kUnknownEpisodeCount;
+  metadata_.episode_length = kUnknownEpisodeLength;
 }
 
 Item::~Item() {
@@ -42,9 +42,7 @@ Item::~Item() {
 ////////////////////////////////////////////////////////////////////////////////
 
 int Item::GetId() const {
-  assert(!metadata_.uid.empty());
-
-  return ToInt(metadata_.uid.at(0));
+  return metadata_.id;
 }
 
 const std::wstring& Item::GetId(enum_t service) const {
@@ -69,17 +67,11 @@ int Item::GetType() const {
 }
 
 int Item::GetEpisodeCount() const {
-  if (metadata_.extent.size() > 0)
-    return metadata_.extent.at(0);
-
-  return kUnknownEpisodeCount;
+  return metadata_.episode_count;
 }
 
 int Item::GetEpisodeLength() const {
-  if (metadata_.extent.size() > 1)
-    return metadata_.extent.at(1);
-
-  return kUnknownEpisodeLength;
+  return metadata_.episode_length;
 }
 
 int Item::GetAiringStatus(bool check_date) const {
@@ -125,17 +117,11 @@ std::vector<std::wstring> Item::GetSynonyms() const {
 }
 
 const Date& Item::GetDateStart() const {
-  if (metadata_.date.size() > 0)
-    return metadata_.date.at(0);
-
-  return EmptyDate();
+  return metadata_.date_start;
 }
 
 const Date& Item::GetDateEnd() const {
-  if (metadata_.date.size() > 1)
-    return metadata_.date.at(1);
-
-  return EmptyDate();
+  return metadata_.date_end;
 }
 
 const std::wstring& Item::GetImageUrl() const {
@@ -149,26 +135,48 @@ enum_t Item::GetAgeRating() const {
   return metadata_.audience;
 }
 
-const std::vector<std::wstring>& Item::GetGenres() const {
+std::vector<std::wstring> Item::GetGenres() const {
+  std::vector<std::wstring> genres;
+  for (const auto& id : metadata_.subject) {
+    genres.push_back(MetadataStrings.Get(id));
+  }
+  return genres;
+}
+
+const std::vector<library::string_id_t>& Item::GetGenreIds() const {
   return metadata_.subject;
 }
 
+const std::wstring& Item::GetJoinedGenres() const {
+  if (joined_genres_.empty() && !metadata_.subject.empty())
+    joined_genres_ = Join(GetGenres(), L", ");
+  return joined_genres_;
+}
+
 int Item::GetPopularity() const {
-  if (metadata_.community.size() > 1)
-    return ToInt(metadata_.community.at(1));
+  return metadata_.popularity;
+}
 
-  return 0;
+std::vector<std::wstring> Item::GetProducers() const {
+  std::vector<std::wstring> producers;
+  for (const auto& id : metadata_.creator) {
+    producers.push_back(MetadataStrings.Get(id));
+  }
+  return producers;
 }
 
-const std::vector<std::wstring>& Item::GetProducers() const {
+const std::vector<library::string_id_t>& Item::GetProducerIds() const {
   return metadata_.creator;
 }
 
-double Item::GetScore() const {
-  if (metadata_.community.size() > 0)
-    return ToDouble(metadata_.community.at(0));
+const std::wstring& Item::GetJoinedProducers() const {
+  if (joined_producers_.empty() && !metadata_.creator.empty())
+    joined_producers_ = Join(GetProducers(), L", ");
+  return joined_producers_;
+}
 
-  return 0.0;
+double Item::GetScore() const {
+  return metadata_.score;
 }
 
 const std::wstring& Item::GetSynopsis() const {
@@ -186,6 +194,9 @@ void Item::SetId(const std::wstring& id, enum_t service) {
     metadata_.uid.resize(service + 1);
 
   metadata_.uid.at(service) = id;
+
+  if (service == sync::kTaiga)
+    metadata_.id = ToInt(id);
 }
 
 void Item::SetSlug(const std::wstring& slug) {
@@ -207,10 +218,7 @@ void Item::SetType(int type) {
 }
 
 void Item::SetEpisodeCount(int number) {
-  if (metadata_.extent.size() < 1)
-    metadata_.extent.resize(1);
-
-  metadata_.extent.at(0) = number;
+  metadata_.episode_count = number;
 
   // TODO: Call it separately
   if (number >= 0)
@@ -219,13 +227,10 @@ void Item::SetEpisodeCount(int number) {
 }
 
 void Item::SetEpisodeLength(int number) {
-  if (metadata_.extent.size() < 2) {
-    if (number <= 0)
-      return;
-    metadata_.extent.resize(2);
-  }
+  if (metadata_.episode_length == kUnknownEpisodeLength && number <= 0)
+    return;
 
-  metadata_.extent.at(1) = number;
+  metadata_.episode_length = number;
 }
 
 void Item::SetAiringStatus(int status) {
@@ -301,13 +306,7 @@ void Item::SetSynonyms(const std::vector<std::wstring>& synonyms) {
 }
 
 void Item::SetDateStart(const Date& date) {
-  if (metadata_.date.size() < 1) {
-    if (!IsValidDate(date))
-      return;
-    metadata_.date.resize(1);
-  }
-
-  metadata_.date.at(0) = date;
+  metadata_.date_start = date;
 }
 
 void Item::SetDateStart(const std::wstring& date) {
@@ -315,13 +314,7 @@ void Item::SetDateStart(const std::wstring& date) {
 }
 
 void Item::SetDateEnd(const Date& date) {
-  if (metadata_.date.size() < 2) {
-    if (!IsValidDate(date))
-      return;
-    metadata_.date.resize(2);
-  }
-
-  metadata_.date.at(1) = date;
+  metadata_.date_end = date;
 }
 
 void Item::SetDateEnd(const std::wstring& date) {
@@ -351,17 +344,15 @@ void Item::SetGenres(const std::wstring& genres) {
 }
 
 void Item::SetGenres(const std::vector<std::wstring>& genres) {
-  metadata_.subject = genres;
+  joined_genres_.clear();
+  metadata_.subject.clear();
+  for (const auto& genre : genres) {
+    metadata_.subject.push_back(MetadataStrings.Intern(genre));
+  }
 }
 
 void Item::SetPopularity(int popularity) {
-  if (metadata_.community.size() < 2) {
-    if (popularity <= 0)
-      return;
-    metadata_.community.resize(2);
-  }
-
-  metadata_.community.at(1) = ToWstr(popularity);
+  metadata_.popularity = std::max(popularity, 0);
 }
 
 void Item::SetProducers(const std::wstring& producers) {
@@ -373,17 +364,15 @@ void Item::SetProducers(const std::wstring& producers) {
 }
 
 void Item::SetProducers(const std::vector<std::wstring>& producers) {
-  metadata_.creator = producers;
+  joined_producers_.clear();
+  metadata_.creator.clear();
+  for (const auto& producer : producers) {
+    metadata_.creator.push_back(MetadataStrings.Intern(producer));
+  }
 }
 
 void Item::SetScore(double score) {
-  if (metadata_.community.size() < 1) {
-    if (score <= 0.0)
-      return;
-    metadata_.community.resize(1);
-  }
-
-  metadata_.community.at(0) = score > 0.0 ? ToWstr(score) : L"";
+  metadata_.score = std::max(score, 0.0);
 }
 
 void Item::SetSynopsis(const std::wstring& synopsis) {
@@ -28,7 +28,6 @@
 enum class QueueSearch;
 
 namespace anime {
-class Database;
 class Episode;
 class Item;
 }
@@ -61,9 +60,13 @@ public:
   const Date& GetDateEnd() const;
   const std::wstring& GetImageUrl() const;
   enum_t GetAgeRating() const;
-  const std::vector<std::wstring>& GetGenres() const;
+  std::vector<std::wstring> GetGenres() const;
+  const std::vector<library::string_id_t>& GetGenreIds() const;
+  const std::wstring& GetJoinedGenres() const;
   int GetPopularity() const;
-  const std::vector<std::wstring>& GetProducers() const;
+  std::vector<std::wstring> GetProducers() const;
+  const std::vector<library::string_id_t>& GetProducerIds() const;
+  const std::wstring& GetJoinedProducers() const;
   double GetScore() const;
   const std::wstring& GetSynopsis() const;
   const time_t GetLastModified() const;
@@ -167,15 +170,17 @@ private:
   // Series information, stored in db\anime.xml
   library::Metadata metadata_;
 
+  // Genres and producers resolved from the string pool and joined for display,
+  // when they are first needed (e.g. by the season browser while painting)
+  mutable std::wstring joined_genres_;
+  mutable std::wstring joined_producers_;
+
   // User information, stored in user\<username>\anime.xml - some items are not
   // in user's list, thus this member is not valid for every item.
   std::shared_ptr<MyInformation> my_info_;
 
   // Local information, stored temporarily
   LocalInformation local_info_;
-
-  // Pointer to the parent database which holds this item
-  static Database* database_;
 };
 
 }  // namespace anime
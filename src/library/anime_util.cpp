@@ -192,7 +192,7 @@ bool MetadataNeedsRefresh(const Item& item) {
 
   if (item.GetSynopsis().empty())
     return true;
-  if (item.GetGenres().empty())
+  if (item.GetGenreIds().empty())
     return true;
   if (item.GetScore() == kUnknownScore && IsAiredYet(item))
     return true;
@@ -207,9 +207,12 @@ bool IsNsfw(const Item& item) {
     return true;
 
   if (item.GetAgeRating() == anime::kUnknownAgeRating) {
-    auto& genres = item.GetGenres();
-    if (std::find(genres.begin(), genres.end(), L"Hentai") != genres.end())
-      return true;
+    library::string_id_t id = 0;
+    if (MetadataStrings.Lookup(L"Hentai", id)) {
+      const auto& genres = item.GetGenreIds();
+      if (std::find(genres.begin(), genres.end(), id) != genres.end())
+        return true;
+    }
   }
 
   return false;
@@ -74,7 +74,7 @@ bool SeasonDatabase::LoadFile(const std::wstring& filename) {
     return false;
   }
 
-  if (!LoadString(StrToWstr(document))) {
+  if (!LoadString(document)) {
     ui::DisplayErrorMessage(L"Could not read anime season file.", path.c_str());
     return false;
   }
@@ -82,9 +82,10 @@ bool SeasonDatabase::LoadFile(const std::wstring& filename) {
   return true;
 }
 
-bool SeasonDatabase::LoadString(const std::wstring& data) {
+bool SeasonDatabase::LoadString(const std::string& data) {
   xml_document document;
-  xml_parse_result parse_result = document.load_string(data.c_str());
+  xml_parse_result parse_result = document.load_buffer(
+      data.data(), data.size(), pugi::parse_default, pugi::encoding_utf8);
 
   if (parse_result.status != pugi::status_ok)
     return false;
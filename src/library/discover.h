@@ -32,7 +32,7 @@ public:
   // file exists.
   bool LoadSeason(const anime::Season& season);
   bool LoadFile(const std::wstring& filename);
-  bool LoadString(const std::wstring& data);
+  bool LoadString(const std::string& data);
 
   bool LoadSeasonFromMemory(const anime::Season& season);
 
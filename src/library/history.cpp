@@ -16,6 +16,11 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+#include "base/file.h"
 #include "base/foreach.h"
 #include "base/log.h"
 #include "base/string.h"
@@ -27,6 +32,7 @@
 #include "taiga/announce.h"
 #include "taiga/path.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "taiga/taiga.h"
 #include "track/media.h"
 #include "track/search.h"
@@ -35,6 +41,13 @@
 class ConfirmationQueue ConfirmationQueue;
 class History History;
 
+// Journal is compacted into the history file after this many entries
+constexpr size_t kMaxJournalSize = 100;
+
+// Queued items are sent together rather than one after another; this limits
+// how many are in flight at once.
+constexpr size_t kMaxQueueUpdateSize = 20;
+
 HistoryItem::HistoryItem()
     : anime_id(anime::ID_UNKNOWN),
       enabled(true),
@@ -44,7 +57,9 @@ HistoryItem::HistoryItem()
 HistoryQueue::HistoryQueue()
     : index(0),
       history(nullptr),
-      updating(false) {
+      updating(false),
+      update_failed_(false),
+      update_succeeded_(false) {
 }
 
 void HistoryQueue::Add(HistoryItem& item, bool save) {
@@ -144,9 +159,11 @@ void HistoryQueue::Add(HistoryItem& item, bool save) {
     items.push_back(item);
   }
 
+  RebuildIndex();
+
   if (anime && save) {
     // Save
-    history->Save();
+    history->SaveIncremental();
 
     // Announce
     if (item.episode) {
@@ -171,23 +188,45 @@ void HistoryQueue::Add(HistoryItem& item, bool save) {
 }
 
 void HistoryQueue::Check(bool automatic) {
-  if (items.empty())
+  // Items that are added during an update are sent after it is complete
+  if (items.empty() || updating)
     return;
 
-  if (!items[index].enabled) {
-    LOGD(L"Item is disabled, removing...");
-    Remove(index, true, true, false);
-    Check(automatic);
-    return;
+  std::vector<HistoryItem> update_items;
+  std::set<int> anime_ids;
+  bool removed = false;
+
+  for (size_t i = index; i < items.size(); ) {
+    const auto& item = items[i];
+
+    if (!item.enabled) {
+      LOGD(L"Item is disabled, removing...");
+      Remove(static_cast<int>(i), false, true, false);
+      removed = true;
+      continue;
+    }
+
+    if (!AnimeDatabase.FindItem(item.anime_id)) {
+      LOGW(L"Item not found in list, removing... ID: {}", item.anime_id);
+      Remove(static_cast<int>(i), false, true, false);
+      removed = true;
+      continue;
+    }
+
+    // Changes to the same anime must be sent in order, so only the first one
+    // can be sent at this time
+    if (anime_ids.insert(item.anime_id).second &&
+        update_items.size() < kMaxQueueUpdateSize) {
+      update_items.push_back(item);
+    }
+    ++i;
   }
 
-  auto anime_item = AnimeDatabase.FindItem(items[index].anime_id);
-  if (!anime_item) {
-    LOGW(L"Item not found in list, removing... ID: {}", items[index].anime_id);
-    Remove(index, true, true, false);
-    Check(automatic);
+  if (removed)
+    history->SaveIncremental();
+
+  if (update_items.empty())
     return;
-  }
 
   if (automatic && !Settings.GetBool(taiga::kApp_Option_EnableSync)) {
     items[index].reason = L"Automatic synchronization is disabled";
@@ -200,22 +239,80 @@ void HistoryQueue::Check(bool automatic) {
     return;
   }
 
-  History.queue.updating = true;
-  ui::ChangeStatusText(L"Updating list... (" + anime::GetPreferredTitle(*anime_item) + L")");
+  updating = true;
+  update_failed_ = false;
+  update_succeeded_ = false;
+  updated_items_.clear();
+  pending_ids_.clear();
+  for (const auto& item : update_items) {
+    pending_ids_.push_back(item.anime_id);
+  }
+
+  if (update_items.size() == 1) {
+    auto anime_item = AnimeDatabase.FindItem(update_items.front().anime_id);
+    ui::ChangeStatusText(L"Updating list... (" + anime::GetPreferredTitle(*anime_item) + L")");
+  } else {
+    ui::ChangeStatusText(L"Updating list... (" + ToWstr(update_items.size()) + L" items)");
+  }
+
+  // Requests are combined or sent in parallel, depending on the service
+  if (!sync::UpdateLibraryEntries(update_items)) {
+    pending_ids_.clear();
+    updating = false;
+  }
+}
+
+void HistoryQueue::FinishUpdate(int anime_id, bool succeeded) {
+  auto it = std::find(pending_ids_.begin(), pending_ids_.end(), anime_id);
+  if (it == pending_ids_.end())
+    return;
+  pending_ids_.erase(it);
+
+  if (succeeded) {
+    // The item that was sent is the first one for the anime
+    for (size_t i = 0; i < items.size(); ++i) {
+      if (items[i].anime_id == anime_id) {
+        const auto history_item = items[i];
+        AnimeDatabase.UpdateItem(history_item);
+        if (Remove(static_cast<int>(i), false, true, true))
+          updated_items_.push_back(history_item);
+        update_succeeded_ = true;
+        break;
+      }
+    }
+  } else {
+    update_failed_ = true;
+  }
+
+  if (!pending_ids_.empty())
+    return;
+
+  updating = false;
+
+  if (update_succeeded_) {
+    AnimeDatabase.SaveList();
+    history->SaveIncremental(updated_items_);
+    updated_items_.clear();
+  }
 
-  AnimeValues* anime_values = static_cast<AnimeValues*>(&items[index]);
-  sync::UpdateLibraryEntry(*anime_values, items[index].anime_id,
-      static_cast<taiga::HttpClientMode>(items[index].mode));
+  // Failures are reported by the caller, and the queue waits for the user to
+  // try again
+  if (update_failed_)
+    return;
+
+  ui::ClearStatusText();
+  Check(false);
 }
 
 void HistoryQueue::Clear(bool save) {
   items.clear();
   index = 0;
+  RebuildIndex();
 
   ui::OnHistoryChange();
 
   if (save)
-    history->Save();
+    history->SaveIncremental();
 }
 
 void HistoryQueue::Merge(bool save) {
@@ -241,60 +338,16 @@ bool HistoryQueue::IsQueued(int anime_id) const {
 }
 
 HistoryItem* HistoryQueue::FindItem(int anime_id, QueueSearch search_mode) {
-  for (auto it = items.rbegin(); it != items.rend(); ++it) {
-    if (it->anime_id == anime_id && it->enabled) {
-      switch (search_mode) {
-        // Date
-        case QueueSearch::DateStart:
-          if (it->date_start)
-            return &(*it);
-          break;
-        case QueueSearch::DateEnd:
-          if (it->date_finish)
-            return &(*it);
-          break;
-        // Episode
-        case QueueSearch::Episode:
-          if (it->episode)
-            return &(*it);
-          break;
-        // Notes
-        case QueueSearch::Notes:
-          if (it->notes)
-            return &(*it);
-          break;
-        // Rewatched times
-        case QueueSearch::RewatchedTimes:
-          if (it->rewatched_times)
-            return &(*it);
-          break;
-        // Rewatching
-        case QueueSearch::Rewatching:
-          if (it->enable_rewatching)
-            return &(*it);
-          break;
-        // Score
-        case QueueSearch::Score:
-          if (it->score)
-            return &(*it);
-          break;
-        // Status
-        case QueueSearch::Status:
-          if (it->status)
-            return &(*it);
-          break;
-        // Tags
-        case QueueSearch::Tags:
-          if (it->tags)
-            return &(*it);
-          break;
-        // Default
-        default:
-          return &(*it);
-      }
-    }
-  }
-  return nullptr;
+  auto it = search_index_.find(anime_id);
+  if (it == search_index_.end())
+    return nullptr;
+
+  auto i = static_cast<size_t>(search_mode);
+  if (i >= it->second.size())
+    i = it->second.size() - 1;  // Any item
+
+  const int position = it->second.at(i);
+  return position > -1 ? &items.at(position) : nullptr;
 }
 
 HistoryItem* HistoryQueue::GetCurrentItem() {
@@ -314,13 +367,16 @@ int HistoryQueue::GetItemCount() {
   return count;
 }
 
-void HistoryQueue::Remove(int index, bool save, bool refresh, bool to_history) {
+bool HistoryQueue::Remove(int index, bool save, bool refresh, bool to_history) {
   if (index == -1)
     index = this->index;
 
+  HistoryItem history_item;
+  bool added_to_history = false;
+
   if (index < static_cast<int>(items.size())) {
     auto it = items.begin() + index;
-    const HistoryItem history_item = *it;
+    history_item = *it;
 
     if (to_history && history_item.episode && *history_item.episode > 0) {
       history->items.push_back(history_item);
@@ -328,6 +384,7 @@ void HistoryQueue::Remove(int index, bool save, bool refresh, bool to_history) {
           static_cast<int>(history->items.size()) > history->limit) {
         history->items.erase(history->items.begin());
       }
+      added_to_history = true;
     }
 
     if (history_item.episode) {
@@ -340,13 +397,16 @@ void HistoryQueue::Remove(int index, bool save, bool refresh, bool to_history) {
     }
 
     items.erase(it);
+    RebuildIndex();
 
     if (refresh)
       ui::OnHistoryChange(&history_item);
   }
 
   if (save)
-    history->Save();
+    history->SaveIncremental(added_to_history ? &history_item : nullptr);
+
+  return added_to_history;
 }
 
 void HistoryQueue::RemoveDisabled(bool save, bool refresh) {
@@ -360,17 +420,63 @@ void HistoryQueue::RemoveDisabled(bool save, bool refresh) {
     }
   }
 
+  RebuildIndex();
+
   if (refresh && needs_refresh)
     ui::OnHistoryChange();
 
   if (save)
-    history->Save();
+    history->SaveIncremental();
+}
+
+void HistoryQueue::RebuildIndex() {
+  // Queued values override the ones in the list
+  for (const auto& pair : search_index_)
+    Stats.InvalidateItem(pair.first);
+
+  search_index_.clear();
+
+  for (size_t i = 0; i < items.size(); ++i) {
+    const auto& item = items.at(i);
+    if (!item.enabled)
+      continue;
+
+    auto it = search_index_.find(item.anime_id);
+    if (it == search_index_.end()) {
+      index_entry_t entry;
+      entry.fill(-1);
+      it = search_index_.emplace(item.anime_id, entry).first;
+    }
+    auto& entry = it->second;
+
+    const auto set_position = [&](QueueSearch search_mode, bool has_value) {
+      if (has_value)
+        entry.at(static_cast<size_t>(search_mode)) = static_cast<int>(i);
+    };
+
+    set_position(QueueSearch::DateStart, item.date_start);
+    set_position(QueueSearch::DateEnd, item.date_finish);
+    set_position(QueueSearch::Episode, item.episode);
+    set_position(QueueSearch::Notes, item.notes);
+    set_position(QueueSearch::RewatchedTimes, item.rewatched_times);
+    set_position(QueueSearch::Rewatching, item.enable_rewatching);
+    set_position(QueueSearch::Score, item.score);
+    set_position(QueueSearch::Status, item.status);
+    set_position(QueueSearch::Tags, item.tags);
+    entry.back() = static_cast<int>(i);
+  }
+
+  for (const auto& pair : search_index_)
+    Stats.InvalidateItem(pair.first);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 History::History()
-    : limit(0) {  // Limit of history items (0 for unlimited)
+    : limit(0),  // Limit of history items (0 for unlimited)
+      journal_id_(0),
+      journal_ready_(false),
+      journal_size_(0) {
   queue.history = this;
 }
 
@@ -386,6 +492,12 @@ void History::Clear(bool save) {
 bool History::Load() {
   items.clear();
   queue.items.clear();
+  queue.index = 0;
+  queue.RebuildIndex();
+
+  journal_id_ = 0;
+  journal_ready_ = false;
+  journal_size_ = 0;
 
   xml_document document;
   std::wstring path = taiga::GetPath(taiga::Path::UserHistory);
@@ -398,14 +510,13 @@ bool History::Load() {
   xml_node node_meta = document.child(L"meta");
   const auto meta_version = XmlReadStrValue(node_meta, L"version");
   semaver::Version version(WstrToStr(meta_version));
+  journal_id_ = XmlReadIntValue(node_meta, L"journal");
 
   // Items
   xml_node node_items = document.child(L"history").child(L"items");
   foreach_xmlnode_(item, node_items, L"item") {
     HistoryItem history_item;
-    history_item.anime_id = item.attribute(L"anime_id").as_int(anime::ID_NOTINLIST);
-    history_item.episode = item.attribute(L"episode").as_int();
-    history_item.time = item.attribute(L"time").value();
+    ReadItem(item, history_item);
 
     if (AnimeDatabase.FindItem(history_item.anime_id)) {
       items.push_back(history_item);
@@ -419,16 +530,33 @@ bool History::Load() {
   if (version < semaver::Version(1, 1, 4)) {
     ReadQueueInCompatibilityMode(document);
   } else {
-    ReadQueue(document);
+    ReadQueue(document.child(L"history").child(L"queue"));
     HandleCompatibility(meta_version);
   }
 
+  // Replay the changes that were made after the file was last saved, and
+  // compact them into a new file
+  if (ReadJournal() > 0)
+    Save();
+
   return true;
 }
 
-void History::ReadQueue(const pugi::xml_document& document) {
-  xml_node node_queue = document.child(L"history").child(L"queue");
+void History::ReadItem(const pugi::xml_node& node_item,
+                       HistoryItem& history_item) {
+  history_item.anime_id = node_item.attribute(L"anime_id").as_int(anime::ID_NOTINLIST);
+  history_item.episode = node_item.attribute(L"episode").as_int();
+  history_item.time = node_item.attribute(L"time").value();
+}
 
+void History::WriteItem(pugi::xml_node& node_item,
+                        const HistoryItem& history_item) {
+  node_item.append_attribute(L"anime_id") = history_item.anime_id;
+  node_item.append_attribute(L"episode") = *history_item.episode;
+  node_item.append_attribute(L"time") = history_item.time.c_str();
+}
+
+void History::ReadQueue(const pugi::xml_node& node_queue) {
   foreach_xmlnode_(item, node_queue, L"item") {
     HistoryItem history_item;
 
@@ -466,26 +594,7 @@ void History::ReadQueue(const pugi::xml_document& document) {
   }
 }
 
-bool History::Save() {
-  xml_document document;
-  std::wstring path = taiga::GetPath(taiga::Path::UserHistory);
-
-  // Write meta
-  xml_node node_meta = document.append_child(L"meta");
-  XmlWriteStrValue(node_meta, L"version", StrToWstr(Taiga.version.to_string()).c_str());
-
-  xml_node node_history = document.append_child(L"history");
-
-  // Write items
-  xml_node node_items = node_history.append_child(L"items");
-  for (const auto& history_item : items) {
-    xml_node node_item = node_items.append_child(L"item");
-    node_item.append_attribute(L"anime_id") = history_item.anime_id;
-    node_item.append_attribute(L"episode") = *history_item.episode;
-    node_item.append_attribute(L"time") = history_item.time.c_str();
-  }
-  // Write queue
-  xml_node node_queue = node_history.append_child(L"queue");
+void History::WriteQueue(pugi::xml_node& node_queue) {
   for (const auto& history_item : queue.items) {
     xml_node node_item = node_queue.append_child(L"item");
     #define APPEND_ATTRIBUTE_INT(x, y) \
@@ -510,8 +619,38 @@ bool History::Save() {
     #undef APPEND_ATTRIBUTE_STR
     #undef APPEND_ATTRIBUTE_INT
   }
+}
+
+bool History::Save() {
+  xml_document document;
+  std::wstring path = taiga::GetPath(taiga::Path::UserHistory);
+
+  // Write meta
+  xml_node node_meta = document.append_child(L"meta");
+  XmlWriteStrValue(node_meta, L"version", StrToWstr(Taiga.version.to_string()).c_str());
+  XmlWriteIntValue(node_meta, L"journal", journal_id_ + 1);
+
+  xml_node node_history = document.append_child(L"history");
+
+  // Write items
+  xml_node node_items = node_history.append_child(L"items");
+  for (const auto& history_item : items) {
+    xml_node node_item = node_items.append_child(L"item");
+    WriteItem(node_item, history_item);
+  }
+  // Write queue
+  xml_node node_queue = node_history.append_child(L"queue");
+  WriteQueue(node_queue);
+
+  if (!XmlWriteDocumentToFile(document, path))
+    return false;
+
+  // Previous journal entries are now included in the file
+  journal_id_ += 1;
+  journal_size_ = 0;
+  journal_ready_ = StartJournal();
 
-  return XmlWriteDocumentToFile(document, path);
+  return true;
 }
 
 int History::TranslateModeFromString(const std::wstring& mode) {
@@ -538,6 +677,123 @@ std::wstring History::TranslateModeToString(int mode) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// The journal is a UTF-8 file with an XML fragment on each line. The first
+// line identifies the history file that it belongs to. Each following entry
+// may contain an item that was added to history, and contains the queue as it
+// was after the change. The queue is expected to be short-lived and small,
+// while history can grow indefinitely, so the cost of a change no longer
+// depends on the size of history.
+
+bool History::SaveIncremental(const HistoryItem* history_item) {
+  std::vector<HistoryItem> history_items;
+  if (history_item)
+    history_items.push_back(*history_item);
+
+  return SaveIncremental(history_items);
+}
+
+bool History::SaveIncremental(const std::vector<HistoryItem>& history_items) {
+  if (!journal_ready_ || journal_size_ >= kMaxJournalSize)
+    return Save();
+
+  xml_document document;
+  xml_node node_entry = document.append_child(L"entry");
+  for (const auto& history_item : history_items) {
+    xml_node node_item = node_entry.append_child(L"item");
+    WriteItem(node_item, history_item);
+  }
+  xml_node node_queue = node_entry.append_child(L"queue");
+  WriteQueue(node_queue);
+
+  std::ostringstream stream;
+  document.save(stream, L"", pugi::format_raw | pugi::format_no_declaration,
+                pugi::encoding_utf8);
+  stream << '\n';
+
+  const auto path = taiga::GetPath(taiga::Path::UserHistoryJournal);
+  if (!AppendToFile(stream.str(), path)) {
+    LOGW(L"Could not append to journal: {}", path);
+    journal_ready_ = false;
+    return Save();
+  }
+
+  journal_size_ += 1;
+
+  return true;
+}
+
+int History::ReadJournal() {
+  std::string buffer;
+  if (!ReadFromFile(taiga::GetPath(taiga::Path::UserHistoryJournal), buffer))
+    return 0;
+
+  bool header_found = false;
+  int entry_count = 0;
+  size_t pos = 0;
+
+  while (pos < buffer.size()) {
+    // The last line is incomplete if we failed while writing it
+    const auto end = buffer.find('\n', pos);
+    if (end == std::string::npos)
+      break;
+
+    xml_document document;
+    const auto parse_result = document.load_buffer(
+        buffer.data() + pos, end - pos, pugi::parse_default,
+        pugi::encoding_utf8);
+    if (parse_result.status != pugi::status_ok)
+      break;
+    pos = end + 1;
+
+    if (!header_found) {
+      xml_node node_journal = document.child(L"journal");
+      if (node_journal.attribute(L"id").as_uint() != journal_id_) {
+        LOGD(L"Journal does not belong to the history file.");
+        return 0;
+      }
+      header_found = true;
+      continue;
+    }
+
+    xml_node node_entry = document.child(L"entry");
+    foreach_xmlnode_(item, node_entry, L"item") {
+      HistoryItem history_item;
+      ReadItem(item, history_item);
+      if (AnimeDatabase.FindItem(history_item.anime_id)) {
+        items.push_back(history_item);
+        if (limit > 0 && static_cast<int>(items.size()) > limit)
+          items.erase(items.begin());
+      }
+    }
+    xml_node node_queue = node_entry.child(L"queue");
+    if (node_queue) {
+      queue.items.clear();
+      queue.index = 0;
+      queue.RebuildIndex();
+      ReadQueue(node_queue);
+    }
+
+    entry_count += 1;
+  }
+
+  if (entry_count > 0) {
+    LOGD(L"Replayed {} journal entries.", entry_count);
+  } else {
+    // We can keep appending to an intact journal with no entries
+    journal_ready_ = header_found && pos == buffer.size();
+  }
+
+  return entry_count;
+}
+
+bool History::StartJournal() {
+  const std::string header =
+      "<journal id=\"" + std::to_string(journal_id_) + "\"/>\n";
+  return SaveToFile(header, taiga::GetPath(taiga::Path::UserHistoryJournal));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 ConfirmationQueue::ConfirmationQueue()
     : in_process_(false) {
 }
@@ -18,8 +18,10 @@
 
 #pragma once
 
+#include <array>
 #include <string>
 #include <queue>
+#include <unordered_map>
 #include <vector>
 
 #include "base/optional.h"
@@ -74,18 +76,35 @@ public:
   void Add(HistoryItem& item, bool save = true);
   void Check(bool automatic = true);
   void Clear(bool save = true);
+  void FinishUpdate(int anime_id, bool succeeded);
   void Merge(bool save = true);
   bool IsQueued(int anime_id) const;
   HistoryItem* FindItem(int anime_id, QueueSearch search_mode);
   HistoryItem* GetCurrentItem();
   int GetItemCount();
-  void Remove(int index = -1, bool save = true, bool refresh = true, bool to_history = true);
+  bool Remove(int index = -1, bool save = true, bool refresh = true, bool to_history = true);
   void RemoveDisabled(bool save = true, bool refresh = true);
 
+  // Must be called after items are modified outside of this class
+  void RebuildIndex();
+
   size_t index;
   std::vector<HistoryItem> items;
   History* history;
   bool updating;
+
+private:
+  // Positions of the latest enabled items with a value for each QueueSearch,
+  // followed by the position of the latest enabled item (-1 if there is none)
+  using index_entry_t = std::array<int, static_cast<size_t>(QueueSearch::Tags) + 2>;
+  std::unordered_map<int, index_entry_t> search_index_;
+
+  // Items that were sent by Check and are waiting for a response, and the
+  // results so far. Local changes are saved once the last response arrives.
+  std::vector<int> pending_ids_;
+  std::vector<HistoryItem> updated_items_;
+  bool update_failed_;
+  bool update_succeeded_;
 };
 
 class History {
@@ -96,6 +115,8 @@ public:
   void Clear(bool save = true);
   bool Load();
   bool Save();
+  bool SaveIncremental(const HistoryItem* history_item = nullptr);
+  bool SaveIncremental(const std::vector<HistoryItem>& history_items);
 
   void HandleCompatibility(const std::wstring& meta_version);
 
@@ -104,8 +125,18 @@ public:
   int limit;
 
 private:
-  void ReadQueue(const pugi::xml_document& document);
+  void ReadItem(const pugi::xml_node& node_item, HistoryItem& history_item);
+  void WriteItem(pugi::xml_node& node_item, const HistoryItem& history_item);
+  void ReadQueue(const pugi::xml_node& node_queue);
   void ReadQueueInCompatibilityMode(const pugi::xml_document& document);
+  void WriteQueue(pugi::xml_node& node_queue);
+
+  int ReadJournal();
+  bool StartJournal();
+
+  unsigned int journal_id_;
+  bool journal_ready_;
+  size_t journal_size_;
 
   int TranslateModeFromString(const std::wstring& mode);
   std::wstring TranslateModeToString(int mode);
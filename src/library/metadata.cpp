@@ -16,10 +16,63 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "metadata.h"
+#include "base/string.h"
+#include "library/metadata.h"
+
+library::StringPool MetadataStrings;
 
 namespace library {
 
+string_id_t StringPool::Intern(const string_t& str) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = ids_.find(str);
+  if (it != ids_.end())
+    return it->second;
+
+  const auto id = static_cast<string_id_t>(strings_.size());
+  strings_.push_back(str);
+  ids_.emplace(str, id);
+
+  return id;
+}
+
+bool StringPool::Lookup(const string_t& str, string_id_t& id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = ids_.find(str);
+  if (it == ids_.end())
+    return false;
+
+  id = it->second;
+  return true;
+}
+
+const string_t& StringPool::Get(string_id_t id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return id < strings_.size() ? strings_[id] : EmptyString();
+}
+
+size_t StringPool::GetSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return strings_.size();
+}
+
+void StringPool::Find(const string_t& str,
+                      std::vector<string_id_t>& ids) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ids.clear();
+  for (size_t i = 0; i < strings_.size(); ++i) {
+    if (InStr(strings_[i], str, 0, true) > -1)
+      ids.push_back(static_cast<string_id_t>(i));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 Title::Title()
     : type(TitleType::Synonym) {
 }
@@ -29,11 +82,16 @@ Title::Title(TitleType type, const string_t& value)
 }
 
 Metadata::Metadata()
-    : audience(0),
-      modified(0),
+    : id(0),
       source(0),
+      type(0),
       status(0),
-      type(0) {
+      audience(0),
+      episode_count(0),
+      episode_length(0),
+      score(0.0),
+      popularity(0),
+      modified(0) {
 }
 
 }  // namespace library
\ No newline at end of file
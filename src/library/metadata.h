@@ -18,11 +18,38 @@
 
 #pragma once
 
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include "base/time.h"
 #include "base/types.h"
 
 namespace library {
 
+typedef unsigned int string_id_t;
+
+// Values such as genres and producers are shared by many items, so each of them
+// is stored once and referred to by its ID. IDs remain valid for the lifetime
+// of the pool.
+class StringPool {
+public:
+  string_id_t Intern(const string_t& str);
+  bool Lookup(const string_t& str, string_id_t& id) const;
+  const string_t& Get(string_id_t id) const;
+  size_t GetSize() const;
+
+  // Finds the values that contain the given string, ignoring case. The IDs are
+  // sorted in ascending order.
+  void Find(const string_t& str, std::vector<string_id_t>& ids) const;
+
+private:
+  mutable std::mutex mutex_;
+  std::deque<string_t> strings_;  // references are not invalidated on growth
+  std::unordered_map<string_t, string_id_t> ids_;
+};
+
 enum class TitleType {
   Unknown,
   Synonym,
@@ -44,26 +71,34 @@ struct Metadata {
   Metadata();
   ~Metadata() {}
 
-  std::vector<string_t> uid;
+  // Fields that are read for every item while sorting, filtering and
+  // calculating statistics are kept together by value, so that they can be
+  // read without following pointers or parsing strings.
+  int id;
   enum_t source;
-  time_t modified;
-
-  string_t title;
-  std::vector<Title> alternative;
-
   enum_t type;
   enum_t status;
   enum_t audience;
+  int episode_count;
+  int episode_length;
+  Date date_start;
+  Date date_end;
+  double score;
+  int popularity;
+  time_t modified;
 
-  std::vector<unsigned short> extent;
-  std::vector<Date> date;
+  std::vector<string_t> uid;
 
-  std::vector<string_t> subject;
-  std::vector<string_t> creator;
+  string_t title;
+  std::vector<Title> alternative;
+
+  std::vector<string_id_t> subject;
+  std::vector<string_id_t> creator;
   std::vector<string_t> resource;
-  std::vector<string_t> community;
 
   string_t description;
 };
 
 }  // namespace library
+
+extern library::StringPool MetadataStrings;
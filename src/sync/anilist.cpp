@@ -32,6 +32,10 @@ namespace anilist {
 
 constexpr auto kRepeatingMediaListStatus = "REPEATING";
 
+// Each entry in a batch adds to the query complexity, which is limited by the
+// server.
+constexpr size_t kMaxLibraryEntryBatchSize = 10;
+
 Service::Service() {
   host_ = L"graphql.anilist.co";
 
@@ -82,6 +86,117 @@ void Service::HandleResponse(Response& response, HttpResponse& http_response) {
   }
 }
 
+size_t Service::GetMaxBatchSize(RequestType request_type) const {
+  switch (request_type) {
+    case kAddLibraryEntry:
+    case kUpdateLibraryEntry:
+      return kMaxLibraryEntryBatchSize;
+  }
+
+  return 1;
+}
+
+void Service::BuildBatchRequest(std::vector<Request>& requests,
+                                HttpRequest& http_request) {
+  if (requests.empty())
+    return;
+
+  // Headers are the same as in a single request
+  BuildRequest(requests.front(), http_request);
+
+  static const std::vector<std::pair<std::string, std::string>> arguments{
+    {"id", "Int"},
+    {"mediaId", "Int"},
+    {"status", "MediaListStatus"},
+    {"scoreRaw", "Int"},
+    {"progress", "Int"},
+    {"repeat", "Int"},
+    {"notes", "String"},
+    {"startedAt", "FuzzyDateInput"},
+    {"completedAt", "FuzzyDateInput"},
+  };
+
+  static const auto fragment{R"(
+fragment mediaListFragment on MediaList {
+  {mediaListFields}
+  media {
+    {mediaFields}
+  }
+})"
+  };
+
+  // Each entry gets its own aliased mutation and set of variables, e.g.
+  // `entry0: SaveMediaListEntry (id: $id0, ...)`
+  std::string declarations;
+  std::string mutations;
+  Json variables = Json::object();
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    const auto suffix = std::to_string(i);
+
+    std::string parameters;
+    for (const auto& argument : arguments) {
+      if (!declarations.empty())
+        declarations += ", ";
+      declarations += "$" + argument.first + suffix + ": " + argument.second;
+      if (!parameters.empty())
+        parameters += ", ";
+      parameters += argument.first + ": $" + argument.first + suffix;
+    }
+    mutations += "  entry" + suffix + ": SaveMediaListEntry (" + parameters +
+                 ") { ...mediaListFragment }\n";
+
+    const auto entry_variables = BuildLibraryVariables(requests[i]);
+    for (auto it = entry_variables.begin(); it != entry_variables.end(); ++it) {
+      variables[it.key() + suffix] = it.value();
+    }
+  }
+
+  const auto query =
+      "mutation (" + declarations + ") {\n" + mutations + "}" + fragment;
+
+  http_request.body = BuildRequestBody(ExpandQuery(query), variables);
+}
+
+void Service::HandleBatchResponse(std::vector<Response>& responses,
+                                  HttpResponse& http_response) {
+  Json root;
+
+  // The request might have failed as a whole (e.g. invalid token)
+  if (!JsonParseString(http_response.body, root) ||
+      !root.count("data") || !root["data"].is_object()) {
+    for (auto& response : responses) {
+      if (RequestSucceeded(response, http_response))
+        response.data[L"error"] = L"Could not parse library entry";
+    }
+    return;
+  }
+
+  const auto& data = root["data"];
+
+  for (size_t i = 0; i < responses.size(); ++i) {
+    auto& response = responses[i];
+    const auto alias = "entry" + std::to_string(i);
+
+    if (data.count(alias) && data[alias].is_object()) {
+      ParseMediaListObject(data[alias]);
+      continue;
+    }
+
+    // Errors are matched to entries by their path
+    if (root.count("errors") && root["errors"].is_array()) {
+      for (const auto& error : root["errors"]) {
+        if (error.count("path") && error["path"].is_array() &&
+            !error["path"].empty() && error["path"].front() == alias) {
+          response.data[L"error"] = StrToWstr(JsonReadStr(error, "message"));
+          break;
+        }
+      }
+    }
+    HandleError(http_response, response);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Request builders
 
@@ -388,6 +503,10 @@ mutation (
 })"
   };
 
+  return BuildRequestBody(ExpandQuery(query), BuildLibraryVariables(request));
+}
+
+Json Service::BuildLibraryVariables(Request& request) const {
   Json variables{
     {"mediaId", ToInt(request.data[canonical_name_ + L"-id"])},
   };
@@ -419,7 +538,7 @@ mutation (
   if (request.data.count(L"date_finish"))
     variables["completedAt"] = TranslateFuzzyDateTo(Date(request.data[L"date_finish"]));
 
-  return BuildRequestBody(ExpandQuery(query), variables);
+  return variables;
 }
 
 std::wstring Service::BuildRequestBody(const std::string& query,
@@ -577,7 +696,7 @@ void Service::ParseUserObject(const Json& json) {
   Settings.Set(taiga::kSync_Service_AniList_RatingSystem, user_.rating_system);
 }
 
-bool Service::ParseResponseBody(const std::wstring& body,
+bool Service::ParseResponseBody(const std::string& body,
                                 Response& response, Json& json) {
   if (JsonParseString(body, json))
     return true;
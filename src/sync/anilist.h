@@ -42,6 +42,10 @@ public:
   void HandleResponse(Response& response, HttpResponse& http_response);
   bool RequestNeedsAuthentication(RequestType request_type) const;
 
+  size_t GetMaxBatchSize(RequestType request_type) const;
+  void BuildBatchRequest(std::vector<Request>& requests, HttpRequest& http_request);
+  void HandleBatchResponse(std::vector<Response>& responses, HttpResponse& http_response);
+
 private:
   REQUEST_AND_RESPONSE(AddLibraryEntry);
   REQUEST_AND_RESPONSE(AuthenticateUser);
@@ -55,6 +59,7 @@ private:
   bool RequestSucceeded(Response& response, const HttpResponse& http_response);
 
   std::wstring BuildLibraryObject(Request& request) const;
+  Json BuildLibraryVariables(Request& request) const;
   std::wstring BuildRequestBody(const std::string& query, const Json& variables) const;
 
   int ParseMediaObject(const Json& json) const;
@@ -62,7 +67,7 @@ private:
   void ParseMediaTitleObject(const Json& json, anime::Item& anime_item) const;
   void ParseUserObject(const Json& json);
 
-  bool ParseResponseBody(const std::wstring& body, Response& response, Json& json);
+  bool ParseResponseBody(const std::string& body, Response& response, Json& json);
 
   std::string ExpandQuery(const std::string& query) const;
   std::wstring GetMediaFields() const;
@@ -303,7 +303,6 @@ void Service::GetLibraryEntries(Response& response, HttpResponse& http_response)
 
   ParseLinks(root, response);
   const auto first_page = response.data[L"prev_page_offset"].empty();
-  const auto next_page = ToInt(response.data[L"next_page_offset"]);
 
   if (!IsPartialLibraryRequest() && first_page) {
     AnimeDatabase.ClearUserData();
@@ -316,10 +315,6 @@ void Service::GetLibraryEntries(Response& response, HttpResponse& http_response)
   for (const auto& value : root["included"]) {
     ParseObject(value);
   }
-
-  if (!next_page) {
-    user_.last_synchronized = time(nullptr);  // current time
-  }
 }
 
 void Service::GetMetadataById(Response& response, HttpResponse& http_response) {
@@ -762,9 +757,10 @@ void Service::ParseLinks(const Json& json, Response& response) const {
 
   parse_link("prev");
   parse_link("next");
+  parse_link("last");
 }
 
-bool Service::ParseResponseBody(const std::wstring& body,
+bool Service::ParseResponseBody(const std::string& body,
                                 Response& response, Json& json) {
   if (JsonParseString(body, json))
     return true;
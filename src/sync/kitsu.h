@@ -62,7 +62,7 @@ private:
   int ParseLibraryObject(const Json& json) const;
   void ParseLinks(const Json& json, Response& response) const;
 
-  bool ParseResponseBody(const std::wstring& body, Response& response, Json& json);
+  bool ParseResponseBody(const std::string& body, Response& response, Json& json);
 
   bool IsPartialLibraryRequest() const;
 };
@@ -16,6 +16,8 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "base/string.h"
 #include "library/anime_db.h"
 #include "library/anime_season.h"
@@ -97,6 +99,16 @@ void Manager::MakeRequest(Request& request) {
       if (request.service_id == kAllServices)
         requests_[http_request.uid].service_id = pair.first;
 
+      if (request.type == kGetLibraryEntries) {
+        win::Lock lock(critical_section_);
+        const auto page_offset = ToInt(request.data[L"page_offset"]);
+        if (page_offset == 0)  // first page
+          library_download_ = LibraryDownload();
+        library_download_.last_page_offset =
+            std::max(library_download_.last_page_offset, page_offset);
+        ++library_download_.pending_pages;
+      }
+
       // Let the service build the HTTP request
       pair.second->BuildRequest(request, http_request);
       http_request.url.Crack(http_request.url.Build());
@@ -108,17 +120,80 @@ void Manager::MakeRequest(Request& request) {
   }
 }
 
+void Manager::MakeRequest(std::vector<Request>& requests) {
+  // Requests are grouped by service and type, so that they can be combined
+  std::map<std::pair<ServiceId, RequestType>, std::vector<Request>> batches;
+
+  for (auto& request : requests) {
+    const auto batch_service = service(request.service_id);
+    if (request.service_id != kAllServices && batch_service &&
+        batch_service->GetMaxBatchSize(request.type) > 1) {
+      batches[std::make_pair(request.service_id, request.type)].push_back(request);
+    } else {
+      // Other requests are sent in parallel
+      MakeRequest(request);
+    }
+  }
+
+  for (auto& pair : batches) {
+    auto& batch_service = *services_[pair.first.first].get();
+    const auto max_batch_size = batch_service.GetMaxBatchSize(pair.first.second);
+    const auto& batch = pair.second;
+
+    for (size_t i = 0; i < batch.size(); i += max_batch_size) {
+      const auto last = std::min(i + max_batch_size, batch.size());
+      if (last - i == 1) {
+        auto request = batch.at(i);
+        MakeRequest(request);
+        continue;
+      }
+
+      HttpRequest http_request;
+      std::vector<Request>* chunk = nullptr;
+      {
+        win::Lock lock(critical_section_);
+        chunk = &batch_requests_[http_request.uid];
+        chunk->assign(batch.begin() + i, batch.begin() + last);
+      }
+
+      batch_service.BuildBatchRequest(*chunk, http_request);
+      http_request.url.Crack(http_request.url.Build());
+
+      ConnectionManager.MakeRequest(http_request,
+                                    RequestTypeToClientMode(pair.first.second));
+    }
+  }
+}
+
 void Manager::HandleHttpError(HttpResponse& http_response, string_t error) {
   win::Lock lock(critical_section_);
 
-  const Request& request = requests_[http_response.uid];
+  auto it = batch_requests_.find(http_response.uid);
+  if (it != batch_requests_.end()) {
+    auto requests = std::move(it->second);
+    batch_requests_.erase(it);
+
+    std::vector<Response> responses(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+      auto& response = responses.at(i);
+      response.service_id = requests.at(i).service_id;
+      response.type = requests.at(i).type;
+      response.data[L"error"] = error;
+      HandleError(requests.at(i), response, http_response, false);
+    }
+
+    HandleBatchUpdateFailures(requests, responses);
+    return;
+  }
+
+  Request& request = requests_[http_response.uid];
 
   Response response;
   response.service_id = request.service_id;
   response.type = request.type;
   response.data[L"error"] = error;
 
-  HandleError(response, http_response);
+  HandleError(request, response, http_response);
 
   // FIXME: Not thread-safe. Invalidates iterators on other threads.
 //requests_.erase(http_response.uid);
@@ -127,13 +202,42 @@ void Manager::HandleHttpError(HttpResponse& http_response, string_t error) {
 void Manager::HandleHttpResponse(HttpResponse& http_response) {
   win::Lock lock(critical_section_);
 
-  const Request& request = requests_[http_response.uid];
+  auto it = batch_requests_.find(http_response.uid);
+  if (it != batch_requests_.end()) {
+    auto requests = std::move(it->second);
+    batch_requests_.erase(it);
+    if (requests.empty())
+      return;
+
+    std::vector<Response> responses(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+      responses.at(i).service_id = requests.at(i).service_id;
+      responses.at(i).type = requests.at(i).type;
+    }
+
+    // Let the service do its thing
+    Service& service = *services_[requests.front().service_id].get();
+    service.HandleBatchResponse(responses, http_response);
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+      HandleResponse(requests.at(i), responses.at(i), http_response, false);
+    }
+
+    HandleBatchUpdateFailures(requests, responses);
+    return;
+  }
+
+  Request& request = requests_[http_response.uid];
 
   Response response;
   response.service_id = request.service_id;
   response.type = request.type;
 
-  HandleResponse(response, http_response);
+  // Let the service do its thing
+  Service& service = *services_[response.service_id].get();
+  service.HandleResponse(response, http_response);
+
+  HandleResponse(request, response, http_response);
 
   // FIXME: Not thread-safe. Invalidates iterators on other threads.
 //requests_.erase(http_response.uid);
@@ -141,8 +245,8 @@ void Manager::HandleHttpResponse(HttpResponse& http_response) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void Manager::HandleError(Response& response, HttpResponse& http_response) {
-  Request& request = requests_[http_response.uid];
+void Manager::HandleError(Request& request, Response& response,
+                          HttpResponse& http_response, bool notify) {
   Service& service = *services_[response.service_id].get();
 
   int anime_id = ::anime::ID_UNKNOWN;
@@ -174,15 +278,20 @@ void Manager::HandleError(Response& response, HttpResponse& http_response) {
       }
       break;
     case kGetLibraryEntries:
-      ui::OnLibraryChangeFailure();
-      ui::ChangeStatusText(response.data[L"error"]);
+      // Other pages might still be on their way, but we only report once
+      if (!library_download_.failed) {
+        ui::OnLibraryChangeFailure();
+        ui::ChangeStatusText(response.data[L"error"]);
+      }
+      HandleLibraryPage(service, request, response, true);
       break;
     case kAddLibraryEntry:
     case kDeleteLibraryEntry:
     case kUpdateLibraryEntry:
-      History.queue.updating = false;
-      ui::OnLibraryUpdateFailure(anime_id, response.data[L"error"],
-                                 response.data.count(L"not_approved"));
+      History.queue.FinishUpdate(anime_id, false);
+      if (notify)
+        ui::OnLibraryUpdateFailure(anime_id, response.data[L"error"],
+                                   response.data.count(L"not_approved"));
       break;
     default:
       ui::ChangeStatusText(response.data[L"error"]);
@@ -190,19 +299,16 @@ void Manager::HandleError(Response& response, HttpResponse& http_response) {
   }
 }
 
-void Manager::HandleResponse(Response& response, HttpResponse& http_response) {
-  // Let the service do its thing
+void Manager::HandleResponse(Request& request, Response& response,
+                             HttpResponse& http_response, bool notify) {
   Service& service = *services_[response.service_id].get();
-  service.HandleResponse(response, http_response);
 
   // Check for error
   if (response.data.count(L"error")) {
-    HandleError(response, http_response);
+    HandleError(request, response, http_response, notify);
     return;
   }
 
-  Request& request = requests_[http_response.uid];
-
   int anime_id = ::anime::ID_UNKNOWN;
   if (request.data.count(L"taiga-id"))
     anime_id = ToInt(request.data[L"taiga-id"]);
@@ -299,35 +405,89 @@ void Manager::HandleResponse(Response& response, HttpResponse& http_response) {
     }
 
     case kGetLibraryEntries: {
-      const auto next_page = ToInt(response.data[L"next_page_offset"]);
-      if (next_page > 0) {
-        GetLibraryEntries(next_page);
-      } else {
-        AnimeDatabase.SaveDatabase();
-        AnimeDatabase.SaveList();
-        ui::ChangeStatusText(L"Successfully downloaded the list.");
-        ui::OnLibraryChange();
-      }
+      HandleLibraryPage(service, request, response, false);
       break;
     }
 
     case kAddLibraryEntry:
     case kDeleteLibraryEntry:
     case kUpdateLibraryEntry: {
-      History.queue.updating = false;
-      ui::ClearStatusText();
-
-      const auto history_item = History.queue.GetCurrentItem();
-      if (history_item) {
-        AnimeDatabase.UpdateItem(*history_item);
-        AnimeDatabase.SaveList();
-        History.queue.Remove();
-        History.queue.Check(false);
-      }
-
+      History.queue.FinishUpdate(anime_id, true);
       break;
     }
   }
 }
 
+void Manager::HandleBatchUpdateFailures(std::vector<Request>& requests,
+                                        std::vector<Response>& responses) {
+  // Failed updates are reported once for the whole batch, rather than once for
+  // each of its items
+  std::vector<int> anime_ids;
+  string_t reason;
+  bool not_approved = false;
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    auto& response = responses.at(i);
+    if (!response.data.count(L"error"))
+      continue;
+    switch (response.type) {
+      case kAddLibraryEntry:
+      case kDeleteLibraryEntry:
+      case kUpdateLibraryEntry:
+        break;
+      default:
+        continue;
+    }
+    auto& request = requests.at(i);
+    if (request.data.count(L"taiga-id"))
+      anime_ids.push_back(ToInt(request.data[L"taiga-id"]));
+    if (reason.empty())
+      reason = response.data[L"error"];
+    if (response.data.count(L"not_approved"))
+      not_approved = true;
+  }
+
+  if (!anime_ids.empty())
+    ui::OnLibraryUpdateFailure(anime_ids, reason, not_approved);
+}
+
+void Manager::HandleLibraryPage(Service& service, Request& request,
+                                Response& response, bool failed) {
+  auto& download = library_download_;
+
+  if (failed)
+    download.failed = true;
+  --download.pending_pages;
+
+  if (!download.failed) {
+    const auto current_page = ToInt(request.data[L"page_offset"]);
+    const auto next_page = ToInt(response.data[L"next_page_offset"]);
+    const auto last_page = ToInt(response.data[L"last_page_offset"]);
+
+    // The first page tells us where the last page is, so we can request the
+    // rest at once. Connection limits are enforced by the HTTP layer.
+    if (current_page == 0 && next_page > 0 && last_page >= next_page) {
+      const auto page_size = next_page - current_page;
+      for (int offset = next_page; offset <= last_page; offset += page_size) {
+        GetLibraryEntries(offset);
+      }
+    }
+
+    // Otherwise we follow the links one page at a time, which also covers
+    // the entries that were added in the meantime
+    if (next_page > download.last_page_offset)
+      GetLibraryEntries(next_page);
+  }
+
+  if (download.pending_pages > 0 || download.failed)
+    return;
+
+  service.user().last_synchronized = time(nullptr);  // current time
+
+  AnimeDatabase.SaveDatabase();
+  AnimeDatabase.SaveList();
+  ui::ChangeStatusText(L"Successfully downloaded the list.");
+  ui::OnLibraryChange();
+}
+
 }  // namespace sync
\ No newline at end of file
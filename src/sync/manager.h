@@ -21,6 +21,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <windows/win/thread.h>
 
@@ -39,6 +40,7 @@ public:
   ~Manager();
 
   void MakeRequest(Request& request);
+  void MakeRequest(std::vector<Request>& requests);
   void HandleHttpError(HttpResponse& http_response, string_t error);
   void HandleHttpResponse(HttpResponse& http_response);
 
@@ -49,11 +51,22 @@ public:
   string_t GetServiceNameById(ServiceId service_id) const;
 
 private:
-  void HandleError(Response& response, HttpResponse& http_response);
-  void HandleResponse(Response& response, HttpResponse& http_response);
+  void HandleError(Request& request, Response& response, HttpResponse& http_response, bool notify = true);
+  void HandleResponse(Request& request, Response& response, HttpResponse& http_response, bool notify = true);
+  void HandleBatchUpdateFailures(std::vector<Request>& requests, std::vector<Response>& responses);
+  void HandleLibraryPage(Service& service, Request& request,
+                         Response& response, bool failed);
+
+  // Library pages are requested in parallel, and may arrive in any order
+  struct LibraryDownload {
+    int last_page_offset = 0;
+    int pending_pages = 0;
+    bool failed = false;
+  } library_download_;
 
   win::CriticalSection critical_section_;
   std::map<std::wstring, Request> requests_;
+  std::map<std::wstring, std::vector<Request>> batch_requests_;
   std::map<ServiceId, std::unique_ptr<Service>> services_;
 };
 
@@ -202,13 +202,17 @@ void Service::UpdateLibraryEntry(Request& request, HttpRequest& http_request) {
 // Response handlers
 
 void Service::AuthenticateUser(Response& response, HttpResponse& http_response) {
-  user_.id = InStr(http_response.body, L"<id>", L"</id>");
-  user_.username = InStr(http_response.body, L"<username>", L"</username>");
+  const auto& body = http_response.GetBodyText();
+
+  user_.id = InStr(body, L"<id>", L"</id>");
+  user_.username = InStr(body, L"<username>", L"</username>");
 }
 
 void Service::GetLibraryEntries(Response& response, HttpResponse& http_response) {
   xml_document document;
-  xml_parse_result parse_result = document.load_string(http_response.body.c_str());
+  xml_parse_result parse_result = document.load_buffer(
+      http_response.body.data(), http_response.body.size(),
+      pugi::parse_default, pugi::encoding_utf8);
 
   if (parse_result.status != pugi::status_ok) {
     response.data[L"error"] = L"Could not parse the list";
@@ -297,21 +301,22 @@ void Service::GetMetadataById(Response& response, HttpResponse& http_response) {
   // - Rank
   // - Popularity
   // - Members
-  string_t id = InStr(http_response.body,
+  const auto& body = http_response.GetBodyText();
+  string_t id = InStr(body,
       L"/anime/", L"/");
-  string_t title = InStr(http_response.body,
+  string_t title = InStr(body,
       L"class=\"hovertitle\">", L"</a>");
-  string_t genres = InStr(http_response.body,
+  string_t genres = InStr(body,
       L"Genres:</span> ", L"<br />");
-  string_t status = InStr(http_response.body,
+  string_t status = InStr(body,
       L"Status:</span> ", L"<br />");
-  string_t type = InStr(http_response.body,
+  string_t type = InStr(body,
       L"Type:</span> ", L"<br />");
-  string_t episodes = InStr(http_response.body,
+  string_t episodes = InStr(body,
       L"Episodes:</span> ", L"<br />");
-  string_t score = InStr(http_response.body,
+  string_t score = InStr(body,
       L"Score:</span> ", L"<br />");
-  string_t popularity = InStr(http_response.body,
+  string_t popularity = InStr(body,
       L"Popularity:</span> ", L"<br />");
 
   bool title_is_truncated = false;
@@ -352,7 +357,9 @@ void Service::GetMetadataById(Response& response, HttpResponse& http_response) {
 
 void Service::SearchTitle(Response& response, HttpResponse& http_response) {
   xml_document document;
-  xml_parse_result parse_result = document.load_string(http_response.body.c_str());
+  xml_parse_result parse_result = document.load_buffer(
+      http_response.body.data(), http_response.body.size(),
+      pugi::parse_default, pugi::encoding_utf8);
 
   if (parse_result.status != pugi::status_ok) {
     response.data[L"error"] = L"Could not parse search results";
@@ -435,6 +442,8 @@ bool Service::RequestSucceeded(Response& response,
     return false;
   }
 
+  const auto& body = http_response.GetBodyText();
+
   // Unauthorized
   if (http_response.code == 401) {
     // MAL doesn't return a meaningful explanation, so we'll just assume that
@@ -448,8 +457,8 @@ bool Service::RequestSucceeded(Response& response,
   if (http_response.code == 403) {
     // Users that haven't logged in to MAL in the past 90 days are required to
     // do so and clear the captcha first.
-    if (InStr(http_response.body, L"Website login required") > -1) {
-      response.data[L"error"] = http_response.body;
+    if (InStr(body, L"Website login required") > -1) {
+      response.data[L"error"] = body;
       response.data[L"website_login_required"] = L"true";
       HandleError(http_response, response);
       return false;
@@ -459,8 +468,8 @@ bool Service::RequestSucceeded(Response& response,
   // Not approved
   // TODO: Remove when MAL fixes its API
   if (http_response.code == 400) {
-    if (InStr(http_response.body, L"This anime has not been approved yet") > -1) {
-      response.data[L"error"] = http_response.body;
+    if (InStr(body, L"This anime has not been approved yet") > -1) {
+      response.data[L"error"] = body;
       response.data[L"not_approved"] = L"true";
       return false;
     }
@@ -469,7 +478,7 @@ bool Service::RequestSucceeded(Response& response,
   // API is down
   // See: https://github.com/erengy/taiga/issues/588
   if (http_response.code == 404) {
-    if (InStr(http_response.body, L"<title>404 Not Found</title>") > -1) {
+    if (InStr(body, L"<title>404 Not Found</title>") > -1) {
       response.data[L"error"] =
           L"API is unavailable. Please contact MyAnimeList's customer service.";
       HandleError(http_response, response);
@@ -479,41 +488,41 @@ bool Service::RequestSucceeded(Response& response,
 
   switch (response.type) {
     case kAddLibraryEntry:
-      if (StartsWith(http_response.body, L"Created"))
+      if (StartsWith(body, L"Created"))
         return true;
       // According to a previous documentation, this method was supposed to
       // "return the unique ID of the row generated by the insert"...
-      if (IsNumericString(http_response.body))
+      if (IsNumericString(body))
         return true;
       // ...but it returned some HTML code instead. We're keeping these lines in
       // case MAL suddenly reverts to the old behavior.
-      if (InStr(http_response.body, L"<title>201 Created</title>") > -1)
+      if (InStr(body, L"<title>201 Created</title>") > -1)
         return true;
       // If we try to add an anime that is already in user's list, MyAnimeList
       // returns a "400 Bad Request" response with "The anime (id: 12345) is
       // already in the list." error message. Here we ignore this error and
       // assume that our request succeeded.
-      if (InStr(http_response.body, L"is already in the list") > -1)
+      if (InStr(body, L"is already in the list") > -1)
         return true;
       break;
     case kAuthenticateUser:
-      if (InStr(http_response.body, L"<username>") > -1)
+      if (InStr(body, L"<username>") > -1)
         return true;
       break;
     case kDeleteLibraryEntry:
-      if (StartsWith(http_response.body, L"Deleted"))
+      if (StartsWith(body, L"Deleted"))
         return true;
       break;
     case kGetLibraryEntries:
-      if (InStr(http_response.body, L"<myanimelist>", 0, true) > -1 &&
-          InStr(http_response.body, L"<myinfo>", 0, true) > -1)
+      if (InStr(body, L"<myanimelist>", 0, true) > -1 &&
+          InStr(body, L"<myinfo>", 0, true) > -1)
         return true;
       break;
     case kGetMetadataById:
-      if (!InStr(http_response.body, L"/anime/", L"/").empty())
+      if (!InStr(body, L"/anime/", L"/").empty())
         return true;
-      if (InStr(http_response.body, L"No such series found") > -1 ||
-          InStr(http_response.body, L"/anime//") > -1) {
+      if (InStr(body, L"No such series found") > -1 ||
+          InStr(body, L"/anime//") > -1) {
         response.data[L"error"] = L"Invalid anime ID";
         response.data[L"invalid_id"] = L"true";
         return false;
@@ -522,7 +531,7 @@ bool Service::RequestSucceeded(Response& response,
     case kSearchTitle:
       return true;
     case kUpdateLibraryEntry:
-      if (StartsWith(http_response.body, L"Updated"))
+      if (StartsWith(body, L"Updated"))
         return true;
       break;
   }
@@ -530,12 +539,12 @@ bool Service::RequestSucceeded(Response& response,
   // Set the error message on failure
   switch (response.type) {
     case kAuthenticateUser:
-      response.data[L"error"] = http_response.body;
+      response.data[L"error"] = body;
       break;
     case kAddLibraryEntry:
     case kDeleteLibraryEntry:
     case kUpdateLibraryEntry: {
-      std::wstring error_message = http_response.body;
+      std::wstring error_message = body;
       ReplaceString(error_message, L"</div><div>", L"\r\n");
       StripHtmlTags(error_message);
       response.data[L"error"] = error_message;
@@ -44,6 +44,22 @@ bool Service::RequestNeedsAuthentication(RequestType request_type) const {
   return false;
 }
 
+size_t Service::GetMaxBatchSize(RequestType request_type) const {
+  return 1;
+}
+
+void Service::BuildBatchRequest(std::vector<Request>& requests,
+                                HttpRequest& http_request) {
+  if (!requests.empty())
+    BuildRequest(requests.front(), http_request);
+}
+
+void Service::HandleBatchResponse(std::vector<Response>& responses,
+                                  HttpResponse& http_response) {
+  if (!responses.empty())
+    HandleResponse(responses.front(), http_response);
+}
+
 const string_t& Service::host() const {
   return host_;
 }
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "base/types.h"
 
 // A service, in Taiga's terms, is a web application that provides an API that
@@ -95,6 +97,12 @@ public:
   virtual void HandleResponse(Response& response, HttpResponse& http_response) = 0;
   virtual bool RequestNeedsAuthentication(RequestType request_type) const;
 
+  // Services that can combine several requests of the same type into a
+  // single HTTP request override these. Each request still gets a response.
+  virtual size_t GetMaxBatchSize(RequestType request_type) const;
+  virtual void BuildBatchRequest(std::vector<Request>& requests, HttpRequest& http_request);
+  virtual void HandleBatchResponse(std::vector<Response>& responses, HttpResponse& http_response);
+
   const string_t& host() const;
   enum_t id() const;
   const string_t& canonical_name() const;
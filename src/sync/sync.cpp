@@ -157,14 +157,14 @@ void Synchronize() {
   }
 }
 
-void UpdateLibraryEntry(AnimeValues& anime_values, int id,
-                        taiga::HttpClientMode http_client_mode) {
-  RequestType request_type = ClientModeToRequestType(http_client_mode);
+static bool BuildLibraryEntryRequest(const AnimeValues& anime_values, int id,
+                                     taiga::HttpClientMode http_client_mode,
+                                     Request& request) {
+  request.type = ClientModeToRequestType(http_client_mode);
 
-  Request request(request_type);
   SetActiveServiceForRequest(request);
   if (!AddAuthenticationToRequest(request))
-    return;
+    return false;
   AddServiceDataToRequest(request, id);
 
   if (anime_values.episode)
@@ -186,7 +186,32 @@ void UpdateLibraryEntry(AnimeValues& anime_values, int id,
   if (anime_values.notes)
     request.data[L"notes"] = *anime_values.notes;
 
-  ServiceManager.MakeRequest(request);
+  return true;
+}
+
+void UpdateLibraryEntry(AnimeValues& anime_values, int id,
+                        taiga::HttpClientMode http_client_mode) {
+  Request request;
+  if (BuildLibraryEntryRequest(anime_values, id, http_client_mode, request))
+    ServiceManager.MakeRequest(request);
+}
+
+bool UpdateLibraryEntries(const std::vector<HistoryItem>& history_items) {
+  std::vector<Request> requests;
+
+  for (const auto& history_item : history_items) {
+    Request request;
+    if (!BuildLibraryEntryRequest(
+            history_item, history_item.anime_id,
+            static_cast<taiga::HttpClientMode>(history_item.mode), request))
+      return false;
+    requests.push_back(request);
+  }
+
+  // The service manager combines these where possible
+  ServiceManager.MakeRequest(requests);
+
+  return true;
 }
 
 void DownloadImage(int id, const string_t& image_url) {
@@ -38,6 +38,7 @@ void SearchTitle(string_t title, int id);
 void Synchronize();
 void UpdateLibraryEntry(AnimeValues& anime_values, int id,
                         taiga::HttpClientMode http_client_mode);
+bool UpdateLibraryEntries(const std::vector<HistoryItem>& history_items);
 
 void DownloadImage(int id, const std::wstring& image_url);
 
@@ -539,7 +539,7 @@ void Twitter::HandleHttpResponse(HttpClientMode mode,
   switch (mode) {
     case kHttpTwitterRequest: {
       bool success = false;
-      oauth_parameter_t parameters = oauth.ParseQueryString(response.body);
+      oauth_parameter_t parameters = oauth.ParseQueryString(response.GetBodyText());
       if (!parameters[L"oauth_token"].empty()) {
         ExecuteLink(L"https://api.twitter.com/oauth/authorize?oauth_token=" +
                     parameters[L"oauth_token"]);
@@ -556,7 +556,7 @@ void Twitter::HandleHttpResponse(HttpClientMode mode,
 
     case kHttpTwitterAuth: {
       bool success = false;
-      oauth_parameter_t parameters = oauth.ParseQueryString(response.body);
+      oauth_parameter_t parameters = oauth.ParseQueryString(response.GetBodyText());
       if (!parameters[L"oauth_token"].empty() &&
           !parameters[L"oauth_token_secret"].empty()) {
         Settings.Set(kShare_Twitter_OauthToken, parameters[L"oauth_token"]);
@@ -569,15 +569,16 @@ void Twitter::HandleHttpResponse(HttpClientMode mode,
     }
 
     case kHttpTwitterPost: {
-      if (InStr(response.body, L"\"errors\"", 0) == -1) {
+      const auto& body = response.GetBodyText();
+      if (InStr(body, L"\"errors\"", 0) == -1) {
         ui::OnTwitterPost(true, L"");
       } else {
         string_t error;
-        int index_begin = InStr(response.body, L"\"message\":\"", 0);
-        int index_end = InStr(response.body, L"\",\"", index_begin);
+        int index_begin = InStr(body, L"\"message\":\"", 0);
+        int index_end = InStr(body, L"\",\"", index_begin);
         if (index_begin > -1 && index_end > -1) {
           index_begin += 11;
-          error = response.body.substr(index_begin, index_end - index_begin);
+          error = body.substr(index_begin, index_end - index_begin);
         }
         ui::OnTwitterPost(false, error);
       }
@@ -16,9 +16,24 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <anitomy/anitomy/anitomy.h>
+
+#include "base/log.h"
 #include "base/string.h"
+#include "base/time.h"
 #include "library/anime_db.h"
+#include "sync/service.h"
 #include "taiga/debug.h"
+#include "taiga/path.h"
+#include "taiga/settings.h"
+#include "track/feed.h"
+#include "track/feed_filter.h"
+#include "track/recognition.h"
 #include "ui/dlg/dlg_main.h"
 #include "ui/dialog.h"
 
@@ -32,7 +47,7 @@ void Tester::Start() {
   t0_ = clock_t::now();
 }
 
-void Tester::Stop(std::wstring str, bool display_result) {
+float Tester::Stop(std::wstring str, bool display_result) {
   using duration_t =
       std::chrono::duration<float, std::chrono::milliseconds::period>;
 
@@ -44,6 +59,8 @@ void Tester::Stop(std::wstring str, bool display_result) {
     str = ToWstr(duration.count(), 2) + L"ms | Text: [" + str + L"]";
     ui::DlgMain.SetText(str);
   }
+
+  return duration.count();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -56,25 +73,502 @@ void Print(std::wstring text) {
 #endif
 }
 
-void Test() {
-  // Define variables
-  std::wstring str;
+// Name and value pairs that make up the results of a benchmark
+using report_t = std::vector<std::pair<std::wstring, std::wstring>>;
 
-  // Start ticking
+// Returns the time it takes to run the function, in milliseconds
+template <typename Function>
+static float Measure(Function function) {
   Tester test;
   test.Start();
+  function();
+  return test.Stop(L"", false);
+}
+
+static std::wstring FormatDuration(float duration) {
+  return ToWstr(duration, 2) + L"ms";
+}
+
+static std::wstring FormatCount(size_t count) {
+  return ToWstr(static_cast<UINT64>(count));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static report_t BenchmarkDatabase() {
+  const int item_count = 50000;
+  const auto path = taiga::GetPath(taiga::Path::Test) + L"anime.xml";
+
+  // Genres and producers are interned into a pool that is shared with the
+  // current session, so we only use the ones that are already there
+  std::vector<std::wstring> genres;
+  std::vector<std::wstring> producers;
+  for (const auto& it : AnimeDatabase.items) {
+    if (genres.empty())
+      genres = it.second.GetGenres();
+    if (producers.size() < 200) {
+      for (const auto& producer : it.second.GetProducers())
+        producers.push_back(producer);
+    }
+  }
+
+  // Generate a synthetic database
+  {
+    anime::Database database;
+    for (int id = 1; id <= item_count; ++id) {
+      auto& item = database.items[id];
+      item.SetId(ToWstr(id), sync::kTaiga);
+      item.SetId(ToWstr(id), sync::kMyAnimeList);
+      item.SetId(ToWstr(id + item_count), sync::kKitsu);
+      item.SetSource(sync::kMyAnimeList);
+      item.SetTitle(L"Anime Title " + ToWstr(id));
+      item.SetEnglishTitle(L"English Title " + ToWstr(id));
+      item.SetSynonyms(L"Synonym " + ToWstr(id) + L"; Other " + ToWstr(id));
+      item.SetType(anime::kTv);
+      item.SetEpisodeCount(1 + id % 50);
+      item.SetEpisodeLength(24);
+      item.SetAiringStatus(anime::kFinishedAiring);
+      item.SetDateStart(Date(1990 + id % 30, 1 + id % 12, 1 + id % 28));
+      item.SetGenres(genres);
+      if (!producers.empty())
+        item.SetProducers(std::vector<std::wstring>{
+            producers.at(id % producers.size())});
+      item.SetScore(5.0 + (id % 50) / 10.0);
+      item.SetPopularity(id);
+      item.SetSynopsis(std::wstring(500, L'a' + id % 26));
+      item.SetLastModified(id);
+    }
+    database.SaveDatabase(path);
+  }
+
+  anime::Database database_xml;
+  const auto duration_xml = Measure([&]() {
+    database_xml.LoadDatabase(path, false);
+  });
+
+  anime::Database database_snapshot;
+  const auto duration_snapshot = Measure([&]() {
+    database_snapshot.LoadDatabase(path, true);
+  });
+
+  return {
+    {L"Items", FormatCount(database_xml.items.size()) + L"/" +
+               FormatCount(database_snapshot.items.size())},
+    {L"XML", FormatDuration(duration_xml)},
+    {L"Snapshot", FormatDuration(duration_snapshot)},
+  };
+}
+
+static report_t BenchmarkFeedFilters() {
+  const size_t item_count = 1000;
+  const size_t filter_count = 50;
+
+  // Generate a synthetic feed with items for the anime in the list
+  Feed feed;
+  auto it = AnimeDatabase.items.begin();
+  for (size_t i = 0; i < item_count; ++i) {
+    if (it == AnimeDatabase.items.end())
+      it = AnimeDatabase.items.begin();
+    FeedItem item;
+    item.title = L"[Group " + ToWstr(static_cast<int>(i % 10)) + L"] Title";
+    item.file_size = 100000000 + i * 1000;
+    item.episode_data.anime_id = it != AnimeDatabase.items.end() ?
+        it->first : anime::ID_UNKNOWN;
+    item.episode_data.set_anime_title(L"Title " + ToWstr(static_cast<int>(i)));
+    item.episode_data.set_episode_number(1 + i % 24);
+    item.episode_data.set_release_group(L"Group " + ToWstr(static_cast<int>(i % 10)));
+    item.episode_data.set_video_resolution(i % 2 ? L"720p" : L"1080p");
+    feed.items.push_back(item);
+    if (it != AnimeDatabase.items.end())
+      ++it;
+  }
+
+  // Repeat the default filters to get the desired count
+  FeedFilterManager manager;
+  while (manager.filters.size() < filter_count) {
+    const size_t size = manager.filters.size();
+    manager.AddPresets();
+    if (manager.filters.size() == size)
+      break;
+  }
+  if (manager.filters.size() > filter_count)
+    manager.filters.resize(filter_count);
+
+  const auto duration = Measure([&]() {
+    manager.Filter(feed, false);
+    manager.Filter(feed, true);
+  });
+
+  size_t discarded = 0;
+  size_t selected = 0;
+  for (const auto& item : feed.items) {
+    if (item.IsDiscarded()) {
+      ++discarded;
+    } else if (item.state == FeedItemState::Selected) {
+      ++selected;
+    }
+  }
+
+  return {
+    {L"Items", FormatCount(feed.items.size())},
+    {L"Filters", FormatCount(manager.filters.size())},
+    {L"Selected", FormatCount(selected)},
+    {L"Discarded", FormatCount(discarded)},
+    {L"Time", FormatDuration(duration)},
+  };
+}
+
+static report_t BenchmarkParser() {
+  // Generate the kind of paths that we would come across in a library scan
+  std::vector<std::wstring> filenames;
+  for (const auto& it : AnimeDatabase.items) {
+    const auto& title = it.second.GetTitle();
+    for (int episode = 1; episode <= 12; ++episode) {
+      filenames.push_back(L"D:\\Anime\\" + title + L"\\Season 1\\[Group] " +
+                          title + L" - " + PadChar(ToWstr(episode), L'0', 2) +
+                          L" [720p].mkv");
+    }
+    if (filenames.size() >= 10000)
+      break;
+  }
+
+  size_t element_count = 0;
+
+  // This is how each filename used to be parsed, with a new parser every time
+  const auto duration_fresh = Measure([&]() {
+    for (const auto& filename : filenames) {
+      anitomy::Anitomy anitomy_instance;
+      Split(Settings[taiga::kRecognition_IgnoredStrings], L"|",
+            anitomy_instance.options().ignored_strings);
+      anitomy_instance.Parse(GetFileName(filename));
+      element_count += anitomy_instance.elements().size();
+    }
+  });
+
+  track::recognition::ParseOptions parse_options;
+  parse_options.parse_path = true;
+
+  const auto duration_reused = Measure([&]() {
+    for (const auto& filename : filenames) {
+      anime::Episode episode;
+      Meow.Parse(filename, parse_options, episode);
+      element_count += episode.elements().size();
+    }
+  });
+
+  return {
+    {L"Files", FormatCount(filenames.size())},
+    {L"New parsers", FormatDuration(duration_fresh)},
+    {L"Reused parsers", FormatDuration(duration_reused)},
+    {L"Elements", FormatCount(element_count)},
+  };
+}
+
+static report_t BenchmarkRecognition() {
+  // Use slightly misspelled titles, so that they can't be found with a simple
+  // lookup and have to be scored against the database
+  std::vector<std::wstring> titles;
+  for (const auto& it : AnimeDatabase.items) {
+    auto title = it.second.GetTitle();
+    if (title.size() > 4) {
+      title.erase(title.size() / 2, 1);
+      titles.push_back(title);
+    }
+    if (titles.size() >= 100)
+      break;
+  }
+
+  auto search_titles = [&titles](std::vector<std::vector<int>>& results,
+                                 bool use_trigram_index) {
+    for (const auto& title : titles) {
+      std::vector<int> anime_ids;
+      Meow.Search(title, anime_ids, use_trigram_index);
+      results.push_back(anime_ids);
+    }
+  };
+
+  std::vector<std::vector<int>> results_index;
+  std::vector<std::vector<int>> results_scan;
+
+  std::vector<int> dummy_ids;
+  Meow.Search(L"", dummy_ids);  // Initialize titles beforehand
+
+  const auto duration_index = Measure([&]() {
+    search_titles(results_index, true);
+  });
+
+  const auto duration_scan = Measure([&]() {
+    search_titles(results_scan, false);
+  });
+
+  size_t mismatches = 0;
+  for (size_t i = 0; i < results_index.size(); ++i) {
+    if (results_index.at(i) != results_scan.at(i))
+      ++mismatches;
+  }
+
+  return {
+    {L"Titles", FormatCount(titles.size())},
+    {L"Trigram index", FormatDuration(duration_index)},
+    {L"Full scan", FormatDuration(duration_scan)},
+    {L"Mismatches", FormatCount(mismatches)},
+  };
+}
 
-  for (int i = 0; i < 10000; i++) {
-    // Do some tests here
-    //       ___
-    //      {o,o}
-    //      |)__)
-    //     --"-"--
-    //      O RLY?
+static report_t BenchmarkStringDistance() {
+  // Compare each title to the others, as the recognition engine would do with
+  // the candidates of a search
+  std::vector<std::wstring> titles;
+  for (const auto& it : AnimeDatabase.items) {
+    titles.push_back(it.second.GetTitle());
+    if (titles.size() >= 500)
+      break;
   }
 
-  // Show result
-  test.Stop(str, true);
+  // Runs the function for each pair of titles
+  auto compare_titles = [&titles](auto function) {
+    return Measure([&]() {
+      for (const auto& title1 : titles) {
+        for (const auto& title2 : titles) {
+          function(title1, title2);
+        }
+      }
+    });
+  };
+
+  double checksum = 0.0;
+  size_t length_checksum = 0;
+
+  const auto duration_jaro_winkler = compare_titles(
+      [&](const std::wstring& title1, const std::wstring& title2) {
+        checksum += JaroWinklerDistance(title1, title2);
+      });
+  const auto duration_levenshtein = compare_titles(
+      [&](const std::wstring& title1, const std::wstring& title2) {
+        checksum += LevenshteinDistance(title1, title2);
+      });
+  const auto duration_lcs = compare_titles(
+      [&](const std::wstring& title1, const std::wstring& title2) {
+        length_checksum += LongestCommonSubsequenceLength(title1, title2);
+        length_checksum += LongestCommonSubstringLength(title1, title2);
+      });
+
+  return {
+    {L"Pairs", FormatCount(titles.size() * titles.size())},
+    {L"Jaro-Winkler", FormatDuration(duration_jaro_winkler)},
+    {L"Levenshtein", FormatDuration(duration_levenshtein)},
+    {L"LCS", FormatDuration(duration_lcs)},
+    {L"Checksum", ToWstr(checksum, 4) + L"/" + FormatCount(length_checksum)},
+  };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Straightforward implementations of the string distance functions, which the
+// optimized versions in base/string.cpp are checked against
+
+static size_t ReferenceLongestCommonSubsequenceLength(const std::wstring& str1,
+                                                      const std::wstring& str2) {
+  std::vector<std::vector<size_t>> table(
+      str1.size() + 1, std::vector<size_t>(str2.size() + 1, 0));
+
+  for (size_t i = 0; i < str1.size(); i++) {
+    for (size_t j = 0; j < str2.size(); j++) {
+      if (str1[i] == str2[j]) {
+        table[i + 1][j + 1] = table[i][j] + 1;
+      } else {
+        table[i + 1][j + 1] = std::max(table[i + 1][j], table[i][j + 1]);
+      }
+    }
+  }
+
+  return table.back().back();
+}
+
+static size_t ReferenceLongestCommonSubstringLength(const std::wstring& str1,
+                                                    const std::wstring& str2) {
+  std::vector<std::vector<size_t>> table(
+      str1.size(), std::vector<size_t>(str2.size(), 0));
+  size_t longest_length = 0;
+
+  for (size_t i = 0; i < str1.size(); i++) {
+    for (size_t j = 0; j < str2.size(); j++) {
+      if (str1[i] == str2[j]) {
+        table[i][j] = (i == 0 || j == 0) ? 1 : table[i - 1][j - 1] + 1;
+        if (table[i][j] > longest_length)
+          longest_length = table[i][j];
+      }
+    }
+  }
+
+  return longest_length;
+}
+
+static double ReferenceLevenshteinDistance(const std::wstring& str1,
+                                           const std::wstring& str2) {
+  std::vector<std::vector<size_t>> table(
+      str1.size() + 1, std::vector<size_t>(str2.size() + 1, 0));
+
+  for (size_t i = 0; i <= str1.size(); i++)
+    table[i][0] = i;
+  for (size_t j = 0; j <= str2.size(); j++)
+    table[0][j] = j;
+
+  for (size_t i = 0; i < str1.size(); i++) {
+    for (size_t j = 0; j < str2.size(); j++) {
+      table[i + 1][j + 1] = std::min(
+          std::min(table[i][j + 1] + 1, table[i + 1][j] + 1),
+          table[i][j] + (str1[i] == str2[j] ? 0 : 1));
+    }
+  }
+
+  const double len = static_cast<double>(std::max(str1.size(), str2.size()));
+  return 1.0 - (table.back().back() / len);
+}
+
+static double ReferenceJaroWinklerDistance(const std::wstring& str1,
+                                           const std::wstring& str2) {
+  const int len1 = static_cast<int>(str1.size());
+  const int len2 = static_cast<int>(str2.size());
+
+  if (!len1 || !len2)
+    return 0.0;
+
+  std::vector<bool> flags1(len1);
+  std::vector<bool> flags2(len2);
+  int m = 0;
+  int t = 0;
+
+  // Each character of str2 is matched with the first unmatched character of
+  // str1 within the range
+  const int range = std::max(0, (std::max(len1, len2) / 2) - 1);
+  for (int i = 0; i < len2; i++) {
+    const int hi = std::min(i + range + 1, len1);
+    for (int j = std::max(i - range, 0); j < hi; j++) {
+      if (str2[i] == str1[j] && !flags1[j]) {
+        flags1[j] = true;
+        flags2[i] = true;
+        m++;
+        break;
+      }
+    }
+  }
+  if (!m)
+    return 0.0;
+
+  for (int i = 0, j = 0; i < len2; i++) {
+    if (!flags2[i])
+      continue;
+    while (!flags1[j])
+      j++;
+    if (str2[i] != str1[j])
+      t++;
+    j++;
+  }
+  t /= 2;
+
+  double dw = ((static_cast<double>(m) / len1) +
+               (static_cast<double>(m) / len2) +
+               (static_cast<double>(m - t) / m)) / 3.0;
+
+  int l = 0;
+  for (int i = 0; i < std::min(std::min(len1, len2), 4); i++)
+    if (str1[i] == str2[i])
+      l++;
+
+  return dw + (l * 0.1 * (1.0 - dw));
+}
+
+static report_t CheckStringKernels() {
+  // A small alphabet results in many matches, and non-ASCII characters are
+  // stored separately from ASCII ones in the pattern masks. Lengths go beyond
+  // 128 characters, so that each version of the functions gets called.
+  const std::wstring alphabet{L'a', L'b', L'c', L'd', L' ',
+                              0x00E9, 0x3042, 0x30A2, 0xFF01};
+  const size_t max_length = 160;
+  const size_t pair_count = 10000;
+
+  std::mt19937 generator(pair_count);  // Same strings each time
+  auto random = [&generator](size_t max) {
+    return std::uniform_int_distribution<size_t>(0, max)(generator);
+  };
+  auto random_char = [&]() {
+    return alphabet.at(random(alphabet.size() - 1));
+  };
+  auto random_string = [&](size_t length) {
+    std::wstring str(length, L'\0');
+    for (auto& c : str)
+      c = random_char();
+    return str;
+  };
+
+  size_t lcs_mismatches = 0;
+  size_t levenshtein_mismatches = 0;
+  size_t jaro_winkler_mismatches = 0;
+
+  const auto duration = Measure([&]() {
+    for (size_t i = 0; i < pair_count; ++i) {
+      const auto str1 = random_string(1 + random(max_length - 1));
+      auto str2 = random_string(random(max_length));
+
+      // Every other pair is made similar, like most titles that are compared
+      if (i % 2) {
+        str2 = str1;
+        for (size_t edits = random(8); edits > 0; --edits)
+          str2[random(str2.size() - 1)] = random_char();
+      }
+
+      if (LongestCommonSubsequenceLength(str1, str2) !=
+              ReferenceLongestCommonSubsequenceLength(str1, str2) ||
+          LongestCommonSubstringLength(str1, str2) !=
+              ReferenceLongestCommonSubstringLength(str1, str2))
+        ++lcs_mismatches;
+      if (LevenshteinDistance(str1, str2) !=
+          ReferenceLevenshteinDistance(str1, str2))
+        ++levenshtein_mismatches;
+      if (JaroWinklerDistance(str1, str2) !=
+              ReferenceJaroWinklerDistance(str1, str2) ||
+          JaroWinklerDistance(str2, str1) !=
+              ReferenceJaroWinklerDistance(str2, str1))
+        ++jaro_winkler_mismatches;
+    }
+  });
+
+  return {
+    {L"Pairs", FormatCount(pair_count)},
+    {L"LCS mismatches", FormatCount(lcs_mismatches)},
+    {L"Levenshtein mismatches", FormatCount(levenshtein_mismatches)},
+    {L"Jaro-Winkler mismatches", FormatCount(jaro_winkler_mismatches)},
+    {L"Time", FormatDuration(duration)},
+  };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Test() {
+  using benchmark_t = report_t (*)();
+  const std::vector<std::pair<std::wstring, benchmark_t>> benchmarks{
+    {L"Database", BenchmarkDatabase},
+    {L"Feed filters", BenchmarkFeedFilters},
+    {L"Parser", BenchmarkParser},
+    {L"Recognition", BenchmarkRecognition},
+    {L"String distance", BenchmarkStringDistance},
+    {L"String kernels", CheckStringKernels},
+  };
+
+  // Each result is written to the log, and the total time is displayed
+  const auto duration = Measure([&benchmarks]() {
+    for (const auto& benchmark : benchmarks) {
+      std::wstring text = benchmark.first;
+      for (const auto& result : benchmark.second()) {
+        text += L" | " + result.first + L": " + result.second;
+      }
+      LOGD(L"{}", text);
+    }
+  });
+
+  ui::DlgMain.SetText(L"Benchmarks: " + FormatCount(benchmarks.size()) +
+                      L" | Time: " + FormatDuration(duration));
 }
 
 }  // namespace debug
@@ -30,7 +30,7 @@ public:
   Tester();
 
   void Start();
-  void Stop(std::wstring str, bool display_result);
+  float Stop(std::wstring str, bool display_result);
 
 private:
   clock_t::time_point t0_;
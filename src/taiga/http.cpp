@@ -21,7 +21,6 @@
 #include "base/format.h"
 #include "base/log.h"
 #include "base/string.h"
-#include "base/url.h"
 #include "library/anime_db.h"
 #include "library/anime_util.h"
 #include "library/discover.h"
@@ -41,11 +40,6 @@ taiga::HttpManager ConnectionManager;
 
 namespace taiga {
 
-// These are the values commonly used by today's web browsers.
-// See: http://www.browserscope.org/?category=network
-const unsigned int kMaxSimultaneousConnections = 10;
-const unsigned int kMaxSimultaneousConnectionsPerHostname = 6;
-
 HttpClient::HttpClient(const HttpRequest& request)
     : base::http::Client(request),
       mode_(kHttpSilent) {
@@ -142,12 +136,9 @@ bool HttpClient::OnRedirect(const std::wstring& address, bool refresh) {
     }
     Cancel();
     return true;
-
-  } else {
-    Url url(address);
-    ConnectionManager.HandleRedirect(request_.url.host, url.host);
-    return false;
   }
+
+  return false;
 }
 
 bool HttpClient::OnProgress() {
@@ -166,7 +157,9 @@ void HttpClient::OnReadComplete() {
 ////////////////////////////////////////////////////////////////////////////////
 
 HttpManager::HttpManager()
-    : shutdown_(false) {
+    : cache_loaded_(false),
+      cache_modified_(false),
+      shutdown_(false) {
 }
 
 void HttpManager::CancelRequest(base::uid_t uid) {
@@ -177,8 +170,23 @@ void HttpManager::CancelRequest(base::uid_t uid) {
 }
 
 void HttpManager::MakeRequest(HttpRequest& request, HttpClientMode mode) {
-  AddToQueue(request, mode);
-  ProcessQueue();
+  if (IsCacheable(mode))
+    AddCacheValidators(request);
+
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (shutdown_) {
+    LOGD(L"Shutting down");
+    return;
+  }
+
+  LOGD(L"ID: {}", request.uid);
+
+  // Connection limits are enforced by the event loop, which queues the
+  // requests that exceed them
+  HttpClient& client = GetClient(request);
+  client.set_mode(mode);
+  client.MakeRequest(request);
 }
 
 void HttpManager::HandleError(HttpResponse& response, const string_t& error) {
@@ -196,21 +204,23 @@ void HttpManager::HandleError(HttpResponse& response, const string_t& error) {
     case kHttpServiceUpdateLibraryEntry:
       ServiceManager.HandleHttpError(client.response_, error);
       break;
+    case kHttpFeedDownload: {
+      auto feed = reinterpret_cast<Feed*>(client.request_.parameter);
+      if (feed)
+        Aggregator.HandleFeedDownloadError(*feed, client.request_.uid);
+      break;
+    }
   }
-
-  FreeConnection(client.request_.url.host);
-  ProcessQueue();
-}
-
-void HttpManager::HandleRedirect(const std::wstring& current_host,
-                                 const std::wstring& next_host) {
-  FreeConnection(current_host);
-  AddConnection(next_host);
 }
 
 void HttpManager::HandleResponse(HttpResponse& response) {
   HttpClient& client = *FindClient(response.uid);
 
+  // A cached response is used if the server tells us that it is unchanged
+  bool modified = true;
+  if (IsCacheable(client.mode()))
+    modified = UpdateCache(client.request(), response);
+
   switch (client.mode()) {
     case kHttpServiceAuthenticateUser:
     case kHttpServiceGetUser:
@@ -227,7 +237,8 @@ void HttpManager::HandleResponse(HttpResponse& response) {
     case kHttpGetLibraryEntryImage: {
       const int anime_id = static_cast<int>(response.parameter);
       if (response.GetStatusCategory() == 200) {
-        SaveToFile(client.write_buffer_, anime::GetImagePath(anime_id));
+        SaveToFile(response.body, anime::GetImagePath(anime_id));
+        Stats.InvalidateLocalData();
         if (ImageDatabase.Reload(anime_id))
           ui::OnLibraryEntryImageChange(anime_id);
       } else if (response.code == 404) {
@@ -243,7 +254,7 @@ void HttpManager::HandleResponse(HttpResponse& response) {
       Feed* feed = reinterpret_cast<Feed*>(response.parameter);
       if (feed) {
         bool automatic = client.mode() == kHttpFeedCheckAuto;
-        Aggregator.HandleFeedCheck(*feed, client.write_buffer_, automatic);
+        Aggregator.HandleFeedCheck(*feed, response.body, automatic, modified);
       }
       break;
     }
@@ -251,9 +262,9 @@ void HttpManager::HandleResponse(HttpResponse& response) {
       auto feed = reinterpret_cast<Feed*>(response.parameter);
       if (feed) {
         if (Aggregator.ValidateFeedDownload(client.request(), response)) {
-          Aggregator.HandleFeedDownload(*feed, client.write_buffer_);
+          Aggregator.HandleFeedDownload(*feed, response.uid, response.body);
         } else {
-          Aggregator.HandleFeedDownloadError(*feed);
+          Aggregator.HandleFeedDownloadError(*feed, response.uid);
         }
       }
       break;
@@ -264,7 +275,7 @@ void HttpManager::HandleResponse(HttpResponse& response) {
           SeasonDatabase.LoadString(response.body)) {
         const auto path = GetPath(Path::DatabaseSeason) +
                           GetFileName(client.request().url.path);
-        SaveToFile(client.write_buffer_, path);
+        SaveToFile(response.body, path);
         Settings.Set(taiga::kApp_Seasons_LastSeason,
                      SeasonDatabase.current_season.GetString());
         SeasonDatabase.Review();
@@ -299,7 +310,7 @@ void HttpManager::HandleResponse(HttpResponse& response) {
     }
     case kHttpTaigaUpdateDownload:
       if (response.GetStatusCategory() == 200 &&
-          SaveToFile(client.write_buffer_, Taiga.Updater.GetDownloadPath())) {
+          SaveToFile(response.body, Taiga.Updater.GetDownloadPath())) {
         Taiga.Updater.RunInstaller();
       } else {
         ui::OnUpdateFailed();
@@ -308,8 +319,12 @@ void HttpManager::HandleResponse(HttpResponse& response) {
       break;
     case kHttpTaigaUpdateRelations: {
       const bool new_season = Taiga.Updater.IsNewSeasonAvailable();
-      if (Meow.ReadRelations(client.write_buffer_) &&
-          SaveToFile(client.write_buffer_, GetPath(Path::DatabaseAnimeRelations))) {
+      if (!modified && !Settings[kRecognition_RelationsLastModified].empty()) {
+        // Relations were already read from the same data
+        LOGD(L"Anime relation data is unchanged.");
+        ui::OnUpdateNotAvailable(false, new_season);
+      } else if (Meow.ReadRelations(response.body) &&
+          SaveToFile(response.body, GetPath(Path::DatabaseAnimeRelations))) {
         LOGD(L"Updated anime relation data.");
         ui::OnUpdateNotAvailable(true, new_season);
       } else {
@@ -321,14 +336,20 @@ void HttpManager::HandleResponse(HttpResponse& response) {
       break;
     }
   }
-
-  FreeConnection(client.request_.url.host);
-  ProcessQueue();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void HttpManager::FlushCache() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (cache_modified_ && SaveCache())
+    cache_modified_ = false;
+}
+
 void HttpManager::FreeMemory() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
   for (auto it = clients_.cbegin(); it != clients_.cend(); ) {
     if (!it->busy()) {
       clients_.erase(it++);
@@ -339,17 +360,30 @@ void HttpManager::FreeMemory() {
 }
 
 void HttpManager::Shutdown() {
-  shutdown_ = true;
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    shutdown_ = true;
+
+    for (auto& client : clients_) {
+      if (client.busy())
+        client.Cancel();
+    }
 
-  for (auto& client : clients_) {
-    if (client.busy())
-      client.Cancel();
+    base::http::Client::event_loop().Stop();
   }
+
+  // Callbacks from the event loop thread might be waiting for the lock
+  base::http::Client::event_loop().Join();
+
+  FlushCache();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 HttpClient* HttpManager::FindClient(base::uid_t uid) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
   for (auto& client : clients_)
     if (client.request().uid == uid)
       return &client;
@@ -360,23 +394,24 @@ HttpClient* HttpManager::FindClient(base::uid_t uid) {
 HttpClient& HttpManager::GetClient(const HttpRequest& request) {
   HttpClient* client = nullptr;
 
+  // Connections are pooled by the event loop rather than by clients, so any
+  // idle client will do
   foreach_(it, clients_) {
-    if (it->allow_reuse() && !it->busy()) {
-      if (IsEqual(it->request().url.host, request.url.host)) {
-        LOGD(L"Reusing client with the ID: {}\nClient's new ID: {}",
-             it->request().uid, request.uid);
-        client = &(*it);
-        // Proxy settings might have changed since then
-        client->set_proxy(Settings[kApp_Connection_ProxyHost],
-                          Settings[kApp_Connection_ProxyUsername],
-                          Settings[kApp_Connection_ProxyPassword]);
-        break;
-      }
+    if (!it->busy()) {
+      LOGD(L"Reusing client with the ID: {}\nClient's new ID: {}",
+           it->request().uid, request.uid);
+      client = &(*it);
+      // Settings might have changed since then
+      client->set_allow_reuse(Settings.GetBool(kApp_Connection_ReuseActive));
+      client->set_proxy(Settings[kApp_Connection_ProxyHost],
+                        Settings[kApp_Connection_ProxyUsername],
+                        Settings[kApp_Connection_ProxyPassword]);
+      break;
     }
   }
 
   if (!client) {
-    clients_.push_back(HttpClient(request));
+    clients_.emplace_back(request);
     client = &clients_.back();
     LOGD(L"Created a new client. Total number of clients is now {}",
          clients_.size());
@@ -385,84 +420,4 @@ HttpClient& HttpManager::GetClient(const HttpRequest& request) {
   return *client;
 }
 
-void HttpManager::AddToQueue(HttpRequest& request, HttpClientMode mode) {
-#ifdef TAIGA_HTTP_MULTITHREADED
-  win::Lock lock(critical_section_);
-
-  LOGD(L"ID: {}", request.uid);
-
-  requests_.push_back(std::make_pair(request, mode));
-#else
-  HttpClient& client = GetClient(request);
-  client.set_mode(mode);
-  client.MakeRequest(request);
-#endif
-}
-
-void HttpManager::ProcessQueue() {
-#ifdef TAIGA_HTTP_MULTITHREADED
-  win::Lock lock(critical_section_);
-
-  unsigned int connections = 0;
-  for (const auto& pair : connections_)
-    connections += pair.second;
-
-  for (size_t i = 0; i < requests_.size(); i++) {
-    if (shutdown_) {
-      LOGD(L"Shutting down");
-      return;
-    }
-
-    if (connections == kMaxSimultaneousConnections) {
-      LOGD(L"Reached max connections");
-      return;
-    }
-
-    const HttpRequest& request = requests_.at(i).first;
-    HttpClientMode mode = requests_.at(i).second;
-
-    if (connections_[request.url.host] == kMaxSimultaneousConnectionsPerHostname) {
-      LOGD(L"Reached max connections for hostname: {}", request.url.host);
-      continue;
-    } else {
-      connections++;
-      connections_[request.url.host]++;
-      LOGD(L"Connections for hostname is now {}: {}",
-           connections_[request.url.host], request.url.host);
-
-      HttpClient& client = GetClient(request);
-      client.set_mode(mode);
-      client.MakeRequest(request);
-
-      requests_.erase(requests_.begin() + i);
-      i--;
-    }
-  }
-#endif
-}
-
-void HttpManager::AddConnection(const string_t& hostname) {
-#ifdef TAIGA_HTTP_MULTITHREADED
-  win::Lock lock(critical_section_);
-
-  connections_[hostname]++;
-  LOGD(L"Connections for hostname is now {}: {}",
-       connections_[hostname], hostname);
-#endif
-}
-
-void HttpManager::FreeConnection(const string_t& hostname) {
-#ifdef TAIGA_HTTP_MULTITHREADED
-  win::Lock lock(critical_section_);
-
-  if (connections_[hostname] > 0) {
-    connections_[hostname]--;
-    LOGD(L"Connections for hostname is now {}: {}",
-         connections_[hostname], hostname);
-  } else {
-    LOGE(L"Connections for hostname was already zero: {}", hostname);
-  }
-#endif
-}
-
 }  // namespace taiga
\ No newline at end of file
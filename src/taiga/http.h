@@ -20,8 +20,7 @@
 
 #include <list>
 #include <map>
-
-#include <windows/win/thread.h>
+#include <mutex>
 
 #include "base/http.h"
 #include "base/types.h"
@@ -87,9 +86,9 @@ public:
   void MakeRequest(HttpRequest& request, HttpClientMode mode);
 
   void HandleError(HttpResponse& response, const string_t& error);
-  void HandleRedirect(const std::wstring& current_host, const std::wstring& next_host);
   void HandleResponse(HttpResponse& response);
 
+  void FlushCache();
   void FreeMemory();
   void Shutdown();
 
@@ -97,15 +96,25 @@ private:
   HttpClient* FindClient(base::uid_t uid);
   HttpClient& GetClient(const HttpRequest& request);
 
-  void AddToQueue(HttpRequest& request, HttpClientMode mode);
-  void ProcessQueue();
-  void AddConnection(const string_t& hostname);
-  void FreeConnection(const string_t& hostname);
+  // Responses to some requests are kept on disk, so that we can send
+  // conditional requests, and skip processing the data if it is unchanged.
+  static bool IsCacheable(HttpClientMode mode);
+  void AddCacheValidators(HttpRequest& request);
+  bool UpdateCache(const HttpRequest& request, HttpResponse& response);
+  void LoadCache();
+  bool SaveCache();
+
+  struct CacheEntry {
+    std::wstring etag;
+    std::wstring last_modified;
+    std::wstring hash;
+  };
+  std::map<std::wstring, CacheEntry> cache_;
+  bool cache_loaded_;
+  bool cache_modified_;
 
   std::list<HttpClient> clients_;
-  std::map<std::wstring, unsigned int> connections_;
-  win::CriticalSection critical_section_;
-  std::vector<std::pair<HttpRequest, HttpClientMode>> requests_;
+  std::recursive_mutex mutex_;
   bool shutdown_;
 };
 
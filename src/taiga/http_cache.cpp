@@ -0,0 +1,192 @@
+/*
+** Taiga
+** Copyright (C) 2010-2018, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/file.h"
+#include "base/log.h"
+#include "base/string.h"
+#include "base/xml.h"
+#include "taiga/http.h"
+#include "taiga/path.h"
+
+namespace taiga {
+
+// FNV-1a
+static UINT64 HashData(const char* data, size_t size) {
+  UINT64 hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static std::wstring GetCacheFilePath(const std::wstring& url) {
+  const auto str = WstrToStr(url);
+  return GetPath(Path::DatabaseHttpCache) +
+         ToWstr(HashData(str.data(), str.size())) + L".bin";
+}
+
+static std::wstring GetHeaderValue(const HttpResponse& response,
+                                   const std::wstring& name) {
+  for (const auto& pair : response.header) {
+    if (IsEqual(pair.first, name))
+      return pair.second;
+  }
+  return std::wstring();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool HttpManager::IsCacheable(HttpClientMode mode) {
+  switch (mode) {
+    case kHttpFeedCheck:
+    case kHttpFeedCheckAuto:
+    case kHttpSeasonsGet:
+    case kHttpTaigaUpdateRelations:
+      return true;
+  }
+
+  return false;
+}
+
+void HttpManager::AddCacheValidators(HttpRequest& request) {
+  if (request.method != L"GET")
+    return;
+
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  LoadCache();
+
+  const auto url = request.url.Build();
+  auto it = cache_.find(url);
+  if (it == cache_.end())
+    return;
+
+  // The server can only tell us that the data is unchanged if we still have it
+  if (!FileExists(GetCacheFilePath(url))) {
+    cache_.erase(it);
+    cache_modified_ = true;
+    return;
+  }
+
+  const auto& entry = it->second;
+  if (!entry.etag.empty())
+    request.header[L"If-None-Match"] = entry.etag;
+  if (!entry.last_modified.empty())
+    request.header[L"If-Modified-Since"] = entry.last_modified;
+}
+
+bool HttpManager::UpdateCache(const HttpRequest& request,
+                              HttpResponse& response) {
+  if (request.method != L"GET")
+    return true;
+
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  LoadCache();
+
+  const auto url = request.url.Build();
+  const auto path = GetCacheFilePath(url);
+  auto it = cache_.find(url);
+
+  // 304 Not Modified
+  if (response.code == 304) {
+    std::string body;
+    if (it == cache_.end() || !ReadFromFile(path, body)) {
+      LOGW(L"Cached response is not available.\nURL: {}", url);
+      return true;
+    }
+    LOGD(L"Using cached response.\nURL: {}", url);
+    response.body = std::move(body);
+    response.code = 200;
+    return false;
+  }
+
+  if (response.GetStatusCategory() != 200)
+    return true;
+
+  // Even if the server doesn't support conditional requests, we can still tell
+  // that the data is unchanged
+  const auto hash = ToWstr(HashData(response.body.data(), response.body.size()));
+  const bool modified = it == cache_.end() || it->second.hash != hash ||
+                        !FileExists(path);
+
+  if (modified && !SaveToFile(response.body, path)) {
+    if (it != cache_.end()) {
+      cache_.erase(it);
+      cache_modified_ = true;
+    }
+    return true;
+  }
+
+  auto& entry = cache_[url];
+  entry.etag = GetHeaderValue(response, L"ETag");
+  entry.last_modified = GetHeaderValue(response, L"Last-Modified");
+  entry.hash = hash;
+
+  // The index is written periodically and on exit, rather than after each
+  // response (see FlushCache)
+  cache_modified_ = true;
+
+  return modified;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void HttpManager::LoadCache() {
+  if (cache_loaded_)
+    return;
+
+  cache_loaded_ = true;
+
+  xml_document document;
+  const auto path = GetPath(Path::DatabaseHttpCache) + L"index.xml";
+  const auto parse_result = document.load_file(path.c_str());
+
+  if (parse_result.status != pugi::status_ok)
+    return;
+
+  xml_node node_cache = document.child(L"cache");
+  foreach_xmlnode_(node_item, node_cache, L"item") {
+    auto& entry = cache_[node_item.attribute(L"url").as_string()];
+    entry.etag = node_item.attribute(L"etag").as_string();
+    entry.last_modified = node_item.attribute(L"last_modified").as_string();
+    entry.hash = node_item.attribute(L"hash").as_string();
+  }
+}
+
+bool HttpManager::SaveCache() {
+  xml_document document;
+  const auto path = GetPath(Path::DatabaseHttpCache) + L"index.xml";
+
+  xml_node node_cache = document.append_child(L"cache");
+  for (const auto& pair : cache_) {
+    const auto& entry = pair.second;
+    xml_node node_item = node_cache.append_child(L"item");
+    node_item.append_attribute(L"url") = pair.first.c_str();
+    if (!entry.etag.empty())
+      node_item.append_attribute(L"etag") = entry.etag.c_str();
+    if (!entry.last_modified.empty())
+      node_item.append_attribute(L"last_modified") = entry.last_modified.c_str();
+    node_item.append_attribute(L"hash") = entry.hash.c_str();
+  }
+
+  return XmlWriteDocumentToFile(document, path);
+}
+
+}  // namespace taiga
@@ -66,8 +66,12 @@ std::wstring GetPath(Path path) {
       return data_path + L"db\\anime.xml";
     case Path::DatabaseAnimeRelations:
       return data_path + L"db\\anime-relations.txt";
+    case Path::DatabaseHttpCache:
+      return data_path + L"db\\http\\";
     case Path::DatabaseImage:
       return data_path + L"db\\image\\";
+    case Path::DatabaseRecognitionCache:
+      return data_path + L"db\\recognition.xml";
     case Path::DatabaseSeason:
       return data_path + L"db\\season\\";
     case Path::Feed:
@@ -90,6 +94,8 @@ std::wstring GetPath(Path path) {
       return data_path + L"user\\";
     case Path::UserHistory:
       return data_path + L"user\\" + GetUserDirectoryName() + L"\\history.xml";
+    case Path::UserHistoryJournal:
+      return data_path + L"user\\" + GetUserDirectoryName() + L"\\history.journal";
     case Path::UserLibrary:
       return data_path + L"user\\" + GetUserDirectoryName() + L"\\anime.xml";
   }
@@ -31,7 +31,9 @@ enum class Path {
   Database,
   DatabaseAnime,
   DatabaseAnimeRelations,
+  DatabaseHttpCache,
   DatabaseImage,
+  DatabaseRecognitionCache,
   DatabaseSeason,
   Feed,
   FeedHistory,
@@ -43,6 +45,7 @@ enum class Path {
   ThemeCurrent,
   User,
   UserHistory,
+  UserHistoryJournal,
   UserLibrary
 };
 
@@ -16,6 +16,10 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 
 #include "base/string.h"
@@ -63,32 +67,147 @@ static const std::set<std::wstring> script_functions = {
   L"upper"
 };
 
-static const std::set<std::wstring> script_variables = {
-  L"animeurl",
-  L"audio",
-  L"checksum",
-  L"episode",
-  L"file",
-  L"folder",
-  L"group",
-  L"id",
-  L"image",
-  L"manual",
-  L"name",
-  L"playstatus",
-  L"resolution",
-  L"rewatching",
-  L"score",
-  L"season",
-  L"status",
-  L"title",
-  L"total",
-  L"user",
-  L"version",
-  L"video",
-  L"watched"
+enum class ScriptVariable {
+  None,
+  AnimeUrl,
+  Audio,
+  Checksum,
+  Episode,
+  File,
+  Folder,
+  Group,
+  Id,
+  Image,
+  Manual,
+  Name,
+  PlayStatus,
+  Resolution,
+  Rewatching,
+  Score,
+  Season,
+  Status,
+  Title,
+  Total,
+  User,
+  Version,
+  Video,
+  Watched,
 };
 
+static const std::map<std::wstring, ScriptVariable> script_variables = {
+  {L"animeurl", ScriptVariable::AnimeUrl},
+  {L"audio", ScriptVariable::Audio},
+  {L"checksum", ScriptVariable::Checksum},
+  {L"episode", ScriptVariable::Episode},
+  {L"file", ScriptVariable::File},
+  {L"folder", ScriptVariable::Folder},
+  {L"group", ScriptVariable::Group},
+  {L"id", ScriptVariable::Id},
+  {L"image", ScriptVariable::Image},
+  {L"manual", ScriptVariable::Manual},
+  {L"name", ScriptVariable::Name},
+  {L"playstatus", ScriptVariable::PlayStatus},
+  {L"resolution", ScriptVariable::Resolution},
+  {L"rewatching", ScriptVariable::Rewatching},
+  {L"score", ScriptVariable::Score},
+  {L"season", ScriptVariable::Season},
+  {L"status", ScriptVariable::Status},
+  {L"title", ScriptVariable::Title},
+  {L"total", ScriptVariable::Total},
+  {L"user", ScriptVariable::User},
+  {L"version", ScriptVariable::Version},
+  {L"video", ScriptVariable::Video},
+  {L"watched", ScriptVariable::Watched},
+};
+
+// A format string that is split into text and variables, so that it doesn't
+// have to be parsed again each time it's evaluated
+class ScriptTemplate {
+public:
+  struct Segment {
+    ScriptVariable variable = ScriptVariable::None;
+    std::wstring text;
+  };
+
+  explicit ScriptTemplate(const std::wstring& str);
+
+  std::vector<Segment> segments;
+};
+
+ScriptTemplate::ScriptTemplate(const std::wstring& str) {
+  auto append_text = [this](const std::wstring& str, size_t pos, size_t n) {
+    if (n > 0) {
+      Segment segment;
+      segment.text.assign(str, pos, n);
+      segments.push_back(segment);
+    }
+  };
+
+  // A variable is enclosed in percent signs. If the name between them is not
+  // valid, the closing sign can't begin another variable.
+  size_t pos_text = 0;
+  size_t pos = 0;
+  while (pos < str.length()) {
+    const size_t pos_var = str.find('%', pos);
+    if (pos_var == std::wstring::npos)
+      break;
+    const size_t pos_end = str.find('%', pos_var + 1);
+    if (pos_end == std::wstring::npos) {
+      pos = pos_var + 1;
+      continue;
+    }
+    const auto it = script_variables.find(
+        str.substr(pos_var + 1, pos_end - pos_var - 1));
+    if (it != script_variables.end()) {
+      append_text(str, pos_text, pos_var - pos_text);
+      Segment segment;
+      segment.variable = it->second;
+      segments.push_back(segment);
+      pos_text = pos_end + 1;
+    }
+    pos = pos_end + 1;
+  }
+  append_text(str, pos_text, str.length() - pos_text);
+}
+
+static std::shared_ptr<const ScriptTemplate> CompileTemplate(
+    const std::wstring& str) {
+  // Format strings come from settings and feed filters, so there are only a
+  // few of them, unless the user is editing one in the format dialog. Feed
+  // filters are evaluated on the HTTP thread, while the UI thread formats
+  // notifications and announcements.
+  struct CacheEntry {
+    std::shared_ptr<const ScriptTemplate> script_template;
+    unsigned long long last_used;
+  };
+  static std::map<std::wstring, CacheEntry> templates;
+  static unsigned long long counter = 0;
+  static std::mutex mutex;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = templates.find(str);
+  if (it == templates.end()) {
+    // Evict the least recently used template
+    if (templates.size() >= 256) {
+      auto oldest = std::min_element(templates.begin(), templates.end(),
+          [](const std::pair<const std::wstring, CacheEntry>& a,
+             const std::pair<const std::wstring, CacheEntry>& b) {
+            return a.second.last_used < b.second.last_used;
+          });
+      templates.erase(oldest);
+    }
+    CacheEntry entry;
+    entry.script_template = std::make_shared<const ScriptTemplate>(str);
+    it = templates.emplace(str, entry).first;
+  }
+
+  it->second.last_used = ++counter;
+
+  // Callers keep the template alive even if it is evicted in the meantime
+  return it->second.script_template;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 std::wstring EvaluateFunction(const std::wstring& func_name,
@@ -332,6 +451,14 @@ bool IsScriptVariable(const std::wstring& str) {
   return script_variables.count(str) > 0;
 }
 
+bool HasScriptVariables(const std::wstring& str) {
+  const auto script_template = CompileTemplate(str);
+  for (const auto& segment : script_template->segments)
+    if (segment.variable != ScriptVariable::None)
+      return true;
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 std::wstring ReplaceVariables(std::wstring str, const anime::Episode& episode,
@@ -340,88 +467,100 @@ std::wstring ReplaceVariables(std::wstring str, const anime::Episode& episode,
   if (!anime_item && is_preview)
     anime_item = &taiga::DummyAnime;
 
-  std::wstring id;
-  if (anime_item)
-    id = anime_item->GetId(taiga::GetCurrentServiceId());
-
   #define VALIDATE(x, y) \
       anime_item ? x : y
   #define ENCODE(x) \
       url_encode ? EscapeScriptEntities(EncodeUrl(x)) : EscapeScriptEntities(x)
-  #define REPLACE(x, y) \
-      if (var == x) { \
-        str.replace(pos_var, var.length() + 2, y); \
-        pos_var += static_cast<int>(std::wstring(y).length()); \
-        continue; \
-      }
-
-  // Prepare episode value
-  std::wstring episode_number = ToWstr(anime::GetEpisodeHigh(episode));
-  TrimLeft(episode_number, L"0");
-
-  // Prepare folder
-  std::wstring folder = episode.folder;
-  TrimRight(folder, L"\\");
 
-  // Replace variables
-  int pos_var = 0;
-  do {
-    pos_var = InStr(str, L"%", pos_var);
-    if (pos_var > -1) {
-      int pos_end = InStr(str, L"%", pos_var + 1);
-      if (pos_end > -1) {
-        std::wstring var = str.substr(pos_var + 1, pos_end - pos_var - 1);
-        if (IsScriptVariable(var)) {
-          REPLACE(L"title", VALIDATE(ENCODE(anime::GetPreferredTitle(*anime_item)), ENCODE(episode.anime_title())));
-          REPLACE(L"watched", VALIDATE(ENCODE(anime::TranslateNumber(anime_item->GetMyLastWatchedEpisode(), L"")), L""));
-          REPLACE(L"total", VALIDATE(ENCODE(anime::TranslateNumber(anime_item->GetEpisodeCount(), L"")), L""));
-          REPLACE(L"score", VALIDATE(ENCODE(anime::TranslateMyScore(anime_item->GetMyScore(), L"")), L""));
-          REPLACE(L"season", VALIDATE(ENCODE(anime::TranslateDateToSeasonString(anime_item->GetDateStart())), L""));
-          REPLACE(L"id", ENCODE(id));
-          REPLACE(L"image", VALIDATE(ENCODE(anime_item->GetImageUrl()), L""));
-          REPLACE(L"status", VALIDATE(ENCODE(ToWstr(anime_item->GetMyStatus())), L""));
-          REPLACE(L"rewatching", VALIDATE(ENCODE(ToWstr(anime_item->GetMyRewatching())), L""));
-          REPLACE(L"name", ENCODE(episode.episode_title()));
-          REPLACE(L"episode", ENCODE(episode_number));
-          REPLACE(L"version", ENCODE(ToWstr(episode.release_version())));
-          REPLACE(L"group", ENCODE(episode.release_group()));
-          REPLACE(L"resolution", ENCODE(episode.video_resolution()));
-          REPLACE(L"video", ENCODE(episode.video_terms()));
-          REPLACE(L"audio", ENCODE(episode.audio_terms()));
-          REPLACE(L"checksum", ENCODE(episode.file_checksum()));
-          REPLACE(L"file", ENCODE(episode.file_name_with_extension()));
-          REPLACE(L"folder", ENCODE(folder));
-          REPLACE(L"user", ENCODE(taiga::GetCurrentUsername()));
-          REPLACE(L"manual", is_manual ? L"true" : L"");
-          switch (MediaPlayers.play_status) {
-            case track::recognition::PlayStatus::Stopped: REPLACE(L"playstatus", L"stopped"); break;
-            case track::recognition::PlayStatus::Playing: REPLACE(L"playstatus", L"playing"); break;
-            case track::recognition::PlayStatus::Updated: REPLACE(L"playstatus", L"updated"); break;
-          }
-          switch (taiga::GetCurrentServiceId()) {
-            case sync::kMyAnimeList:
-              REPLACE(L"animeurl", ENCODE(sync::myanimelist::GetAnimePage(*anime_item)));
-              break;
-            case sync::kKitsu:
-              REPLACE(L"animeurl", ENCODE(sync::kitsu::GetAnimePage(*anime_item)));
-              break;
-            case sync::kAniList:
-              REPLACE(L"animeurl", ENCODE(sync::anilist::GetAnimePage(*anime_item)));
-              break;
-          }
-        } else {
-          pos_var = pos_end + 1;
-        }
-      } else {
-        pos_var++;
+  auto get_variable_value = [&](ScriptVariable variable) -> std::wstring {
+    switch (variable) {
+      case ScriptVariable::Title:
+        return VALIDATE(ENCODE(anime::GetPreferredTitle(*anime_item)), ENCODE(episode.anime_title()));
+      case ScriptVariable::Watched:
+        return VALIDATE(ENCODE(anime::TranslateNumber(anime_item->GetMyLastWatchedEpisode(), L"")), L"");
+      case ScriptVariable::Total:
+        return VALIDATE(ENCODE(anime::TranslateNumber(anime_item->GetEpisodeCount(), L"")), L"");
+      case ScriptVariable::Score:
+        return VALIDATE(ENCODE(anime::TranslateMyScore(anime_item->GetMyScore(), L"")), L"");
+      case ScriptVariable::Season:
+        return VALIDATE(ENCODE(anime::TranslateDateToSeasonString(anime_item->GetDateStart())), L"");
+      case ScriptVariable::Id: {
+        std::wstring id;
+        if (anime_item)
+          id = anime_item->GetId(taiga::GetCurrentServiceId());
+        return ENCODE(id);
+      }
+      case ScriptVariable::Image:
+        return VALIDATE(ENCODE(anime_item->GetImageUrl()), L"");
+      case ScriptVariable::Status:
+        return VALIDATE(ENCODE(ToWstr(anime_item->GetMyStatus())), L"");
+      case ScriptVariable::Rewatching:
+        return VALIDATE(ENCODE(ToWstr(anime_item->GetMyRewatching())), L"");
+      case ScriptVariable::Name:
+        return ENCODE(episode.episode_title());
+      case ScriptVariable::Episode: {
+        std::wstring episode_number = ToWstr(anime::GetEpisodeHigh(episode));
+        TrimLeft(episode_number, L"0");
+        return ENCODE(episode_number);
       }
+      case ScriptVariable::Version:
+        return ENCODE(ToWstr(episode.release_version()));
+      case ScriptVariable::Group:
+        return ENCODE(episode.release_group());
+      case ScriptVariable::Resolution:
+        return ENCODE(episode.video_resolution());
+      case ScriptVariable::Video:
+        return ENCODE(episode.video_terms());
+      case ScriptVariable::Audio:
+        return ENCODE(episode.audio_terms());
+      case ScriptVariable::Checksum:
+        return ENCODE(episode.file_checksum());
+      case ScriptVariable::File:
+        return ENCODE(episode.file_name_with_extension());
+      case ScriptVariable::Folder: {
+        std::wstring folder = episode.folder;
+        TrimRight(folder, L"\\");
+        return ENCODE(folder);
+      }
+      case ScriptVariable::User:
+        return ENCODE(taiga::GetCurrentUsername());
+      case ScriptVariable::Manual:
+        return is_manual ? L"true" : L"";
+      case ScriptVariable::PlayStatus:
+        switch (MediaPlayers.play_status) {
+          case track::recognition::PlayStatus::Stopped: return L"stopped";
+          case track::recognition::PlayStatus::Playing: return L"playing";
+          case track::recognition::PlayStatus::Updated: return L"updated";
+        }
+        break;
+      case ScriptVariable::AnimeUrl:
+        switch (taiga::GetCurrentServiceId()) {
+          case sync::kMyAnimeList:
+            return ENCODE(sync::myanimelist::GetAnimePage(*anime_item));
+          case sync::kKitsu:
+            return ENCODE(sync::kitsu::GetAnimePage(*anime_item));
+          case sync::kAniList:
+            return ENCODE(sync::anilist::GetAnimePage(*anime_item));
+        }
+        break;
     }
-  } while (pos_var > -1);
+    return std::wstring();
+  };
 
-  #undef REPLACE
   #undef ENCODE
   #undef VALIDATE
 
+  // Replace variables
+  const auto script_template = CompileTemplate(str);
+  str.clear();
+  for (const auto& segment : script_template->segments) {
+    if (segment.variable == ScriptVariable::None) {
+      str.append(segment.text);
+    } else {
+      str.append(get_variable_value(segment.variable));
+    }
+  }
+
   // Replace special characters
   ReplaceString(str, L"\\n", L"\n");
   ReplaceString(str, L"\\t", L"\t");
@@ -463,9 +602,8 @@ std::wstring ReplaceVariables(std::wstring str, const anime::Episode& episode,
                     str.substr(pos_func + 1, pos_left - (pos_func + 1));
                 std::wstring func_body =
                     str.substr(pos_left + 1, pos_right - (pos_left + 1));
-                str = str.substr(0, pos_func) +
-                      str.substr(pos_right + 1, str.length() - (pos_right + 1));
-                str.insert(pos_func, EvaluateFunction(func_name, func_body));
+                str.replace(pos_func, pos_right + 1 - pos_func,
+                            EvaluateFunction(func_name, func_body));
                 i = str.length();
               }
               if (open_brackets > 0)
@@ -486,8 +624,15 @@ std::wstring ReplaceVariables(std::wstring str, const anime::Episode& episode,
   str = UnescapeScriptEntities(str);
 
   // Clean-up
-  while (ReplaceString(str, L"\n\n", L"\n"));
-  while (ReplaceString(str, L"  ", L" "));
+  size_t length = 0;
+  for (size_t i = 0; i < str.length(); ++i) {
+    // Collapse consecutive line breaks and spaces into one
+    if (length > 0 && str[i] == str[length - 1] &&
+        (str[i] == '\n' || str[i] == ' '))
+      continue;
+    str[length++] = str[i];
+  }
+  str.resize(length);
   Trim(str, L"\t\n\r ");
 
   // Return
@@ -30,6 +30,7 @@ std::wstring EvaluateFunction(const std::wstring& func_name, const std::wstring&
 
 bool IsScriptFunction(const std::wstring& str);
 bool IsScriptVariable(const std::wstring& str);
+bool HasScriptVariables(const std::wstring& str);
 
 std::wstring ReplaceVariables(std::wstring str,
                               const anime::Episode& episode,
@@ -42,6 +42,7 @@
 #include "taiga/version.h"
 #include "track/media.h"
 #include "track/monitor.h"
+#include "track/recognition.h"
 #include "ui/dlg/dlg_anime_list.h"
 #include "ui/dlg/dlg_season.h"
 #include "ui/menu.h"
@@ -105,7 +106,7 @@ const ULONGLONG kDefaultFileSizeThreshold = 1024 * 1024 * 10;
 ////////////////////////////////////////////////////////////////////////////////
 
 void AppSettings::InitializeMap() {
-  if (!map_.empty())
+  if (!items_.empty())
     return;
 
   #define INITKEY(name, def, path) InitializeKey(name, def, path);
@@ -232,6 +233,7 @@ void AppSettings::InitializeMap() {
   INITKEY(kTorrent_Download_SortBy, L"episode_number", L"rss/torrent/options/downloadsortby");
   INITKEY(kTorrent_Download_SortOrder, L"ascending", L"rss/torrent/options/downloadsortorder");
   INITKEY(kTorrent_Download_UseMagnet, L"false", L"rss/torrent/options/downloadusemagnet");
+  INITKEY(kTorrent_Download_MaxParallel, L"4", L"rss/torrent/options/downloadmaxparallel");
   INITKEY(kTorrent_Filter_Enabled, L"true", L"rss/torrent/filter/enabled");
   INITKEY(kTorrent_Filter_ArchiveMaxCount, L"1000", L"rss/torrent/filter/archive_maxcount");
 
@@ -253,6 +255,16 @@ void AppSettings::InitializeMap() {
   INITKEY(kApp_Seasons_ViewAs, ToWstr(ui::kSeasonViewAsTiles).c_str(), L"program/seasons/viewas");
 
   #undef INITKEY
+
+  InitializeList(kApp_Interface_ExternalLinks, L"\r\n");
+  InitializeList(kRecognition_IgnoredStrings, L"|");
+
+  AddObserver(kApp_Interface_ExternalLinks, [](enum_t) {
+    ui::Menus.UpdateExternalLinks();
+  });
+  AddObserver(kRecognition_IgnoredStrings, [](enum_t) {
+    Meow.InvalidateParsers();
+  });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -513,7 +525,6 @@ void AppSettings::ApplyChanges(const AppSettings previous) {
     }
   }
 
-  ui::Menus.UpdateExternalLinks();
   ui::Menus.UpdateFolders();
 
   timers.UpdateIntervalsFromSettings();
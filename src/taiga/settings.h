@@ -160,6 +160,7 @@ enum AppSettingName {
   kTorrent_Download_SortBy,
   kTorrent_Download_SortOrder,
   kTorrent_Download_UseMagnet,
+  kTorrent_Download_MaxParallel,
   kTorrent_Filter_Enabled,
   kTorrent_Filter_ArchiveMaxCount,
 
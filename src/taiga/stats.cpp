@@ -17,6 +17,7 @@
 */
 
 #include <algorithm>
+#include <cmath>
 
 #include "base/file.h"
 #include "library/anime_db.h"
@@ -42,7 +43,14 @@ Statistics::Statistics()
       tigers_harmed(0),
       torrent_count(0),
       torrent_size(0),
-      uptime(0) {
+      uptime(0),
+      items_changed_(true),
+      local_data_changed_(true),
+      items_scored_(0),
+      seconds_planned_(0),
+      seconds_spent_(0),
+      sum_scores_(0.0),
+      sum_squares_(0.0) {
 }
 
 void Statistics::CalculateAll() {
@@ -50,76 +58,40 @@ void Statistics::CalculateAll() {
   CalculateEpisodeCount();
   CalculateLifePlannedToWatch();
   CalculateLifeSpentWatching();
-  CalculateLocalData();
+  if (local_data_changed_)
+    CalculateLocalData();
   CalculateMeanScore();
   CalculateScoreDeviation();
   CalculateScoreDistribution();
 }
 
 int Statistics::CalculateAnimeCount() {
-  anime_count = 0;
+  UpdateItems();
 
-  for (const auto& pair : AnimeDatabase.items)
-    if (pair.second.IsInList())
-      anime_count++;
+  anime_count = static_cast<int>(item_values_.size());
 
   return anime_count;
 }
 
 int Statistics::CalculateEpisodeCount() {
-  episode_count = 0;
-
-  for (const auto& pair : AnimeDatabase.items) {
-    if (!pair.second.IsInList())
-      continue;
-
-    episode_count += pair.second.GetMyLastWatchedEpisode();
-    episode_count += anime::GetMyRewatchedTimes(pair.second) *
-                     pair.second.GetEpisodeCount();
-  }
+  UpdateItems();
 
   return episode_count;
 }
 
 const std::wstring& Statistics::CalculateLifePlannedToWatch() {
-  int seconds = 0;
-
-  for (const auto& pair : AnimeDatabase.items) {
-    const auto& item = pair.second;
+  UpdateItems();
 
-    switch (item.GetMyStatus()) {
-      case anime::kNotInList:
-      case anime::kCompleted:
-      case anime::kDropped:
-        continue;
-    }
-
-    int episodes = EstimateEpisodeCount(item) - item.GetMyLastWatchedEpisode();
-
-    seconds += (EstimateDuration(item) * 60) * episodes;
-  }
-
-  life_planned_to_watch = seconds > 0 ? ToDateString(seconds) : L"None";
+  life_planned_to_watch = seconds_planned_ > 0 ?
+      ToDateString(seconds_planned_) : L"None";
   return life_planned_to_watch;
 }
 
 const std::wstring& Statistics::CalculateLifeSpentWatching() {
-  int seconds = 0;
-
-  for (const auto& pair : AnimeDatabase.items) {
-    const auto& item = pair.second;
-
-    if (!item.IsInList())
-      continue;
+  UpdateItems();
 
-    int episodes_watched = item.GetMyLastWatchedEpisode();
-    episodes_watched += anime::GetMyRewatchedTimes(item) *
-                        item.GetEpisodeCount();
-
-    seconds += (EstimateDuration(item) * 60) * episodes_watched;
-  }
-
-  life_spent_watching = seconds > 0 ? ToDateString(seconds) : L"None";
+  life_spent_watching = seconds_spent_ > 0 ?
+      ToDateString(seconds_spent_) : L"None";
   return life_spent_watching;
 }
 
@@ -134,63 +106,41 @@ void Statistics::CalculateLocalData() {
 
   torrent_count = PopulateFiles(file_list, path, L"torrent", true);
   torrent_size = GetFolderSize(path, true);
+
+  local_data_changed_ = false;
 }
 
 float Statistics::CalculateMeanScore() {
-  float items_scored = 0.0f;
-  float sum_scores = 0.0f;
-
-  for (const auto& pair : AnimeDatabase.items) {
-    if (!pair.second.IsInList())
-      continue;
-
-    if (pair.second.GetMyScore() > 0) {
-      sum_scores += static_cast<float>(pair.second.GetMyScore());
-      items_scored++;
-    }
-  }
+  UpdateItems();
 
-  score_mean = items_scored > 0 ? (sum_scores / items_scored) : 0.0f;
+  score_mean = items_scored_ > 0 ?
+      static_cast<float>(sum_scores_ / items_scored_) : 0.0f;
 
   return score_mean;
 }
 
 float Statistics::CalculateScoreDeviation() {
-  float items_scored = 0.0f;
-  float sum_squares = 0.0f;
-
-  for (const auto& pair : AnimeDatabase.items) {
-    if (!pair.second.IsInList())
-      continue;
-
-    if (pair.second.GetMyScore() > 0) {
-      float score = static_cast<float>(pair.second.GetMyScore());
-      sum_squares += pow(score - score_mean, 2);
-      items_scored++;
-    }
+  UpdateItems();
+
+  if (items_scored_ > 0) {
+    const double mean = sum_scores_ / items_scored_;
+    const double variance = sum_squares_ / items_scored_ - mean * mean;
+    score_deviation = static_cast<float>(std::sqrt(std::max(variance, 0.0)));
+  } else {
+    score_deviation = 0.0f;
   }
 
-  score_deviation = items_scored > 0 ? sqrt(sum_squares / items_scored) : 0.0f;
-
   return score_deviation;
 }
 
 const std::vector<float>& Statistics::CalculateScoreDistribution() {
-  for (auto& value : score_count)
-    value = 0;
-  for (auto& value : score_distribution)
-    value = 0.0f;
+  UpdateItems();
 
   float extreme_value = 1.0f;
 
-  for (const auto& pair : AnimeDatabase.items) {
-    int score = pair.second.GetMyScore();
-    if (score > 0) {
-      const auto score_index = static_cast<size_t>(std::floor(score / 10.0));
-      score_count[score_index]++;
-      score_distribution[score_index]++;
-      extreme_value = std::max(score_distribution[score_index], extreme_value);
-    }
+  for (size_t i = 0; i < score_count.size(); ++i) {
+    score_distribution[i] = static_cast<float>(score_count[i]);
+    extreme_value = std::max(score_distribution[i], extreme_value);
   }
 
   for (auto& value : score_distribution)
@@ -199,4 +149,96 @@ const std::vector<float>& Statistics::CalculateScoreDistribution() {
   return score_distribution;
 }
 
-}  // namespace taiga
\ No newline at end of file
+////////////////////////////////////////////////////////////////////////////////
+
+void Statistics::InvalidateItem(int anime_id) {
+  if (!items_changed_)
+    changed_items_.insert(anime_id);
+}
+
+void Statistics::InvalidateItems() {
+  items_changed_ = true;
+  changed_items_.clear();
+}
+
+void Statistics::InvalidateLocalData() {
+  local_data_changed_ = true;
+}
+
+void Statistics::AddItemValues(const ItemValues& values, int sign) {
+  episode_count += sign * values.episodes;
+  seconds_planned_ += sign * values.seconds_planned;
+  seconds_spent_ += sign * values.seconds_spent;
+
+  if (values.score > 0) {
+    const double score = static_cast<double>(values.score);
+    const auto score_index = static_cast<size_t>(std::floor(score / 10.0));
+    items_scored_ += sign;
+    sum_scores_ += sign * score;
+    sum_squares_ += sign * score * score;
+    score_count[score_index] += sign;
+  }
+}
+
+void Statistics::UpdateItems() {
+  const auto update_item = [this](int anime_id) {
+    auto it = item_values_.find(anime_id);
+    if (it != item_values_.end()) {
+      AddItemValues(it->second, -1);
+      item_values_.erase(it);
+    }
+
+    const auto item = AnimeDatabase.FindItem(anime_id, false);
+    if (!item || !item->IsInList())
+      return;
+
+    ItemValues values;
+
+    const int duration = anime::EstimateDuration(*item) * 60;
+    const int episodes_watched = item->GetMyLastWatchedEpisode() +
+        anime::GetMyRewatchedTimes(*item) * item->GetEpisodeCount();
+
+    values.episodes = episodes_watched;
+    values.score = item->GetMyScore();
+    values.seconds_spent = duration * episodes_watched;
+
+    switch (item->GetMyStatus()) {
+      case anime::kCompleted:
+      case anime::kDropped:
+        break;
+      default:
+        values.seconds_planned = duration *
+            (anime::EstimateEpisodeCount(*item) -
+             item->GetMyLastWatchedEpisode());
+        break;
+    }
+
+    AddItemValues(values, 1);
+    item_values_.emplace(anime_id, values);
+  };
+
+  if (items_changed_) {
+    item_values_.clear();
+    changed_items_.clear();
+    episode_count = 0;
+    items_scored_ = 0;
+    seconds_planned_ = 0;
+    seconds_spent_ = 0;
+    sum_scores_ = 0.0;
+    sum_squares_ = 0.0;
+    for (auto& value : score_count)
+      value = 0;
+
+    for (const auto& pair : AnimeDatabase.items)
+      update_item(pair.first);
+
+    items_changed_ = false;
+
+  } else if (!changed_items_.empty()) {
+    for (const auto anime_id : changed_items_)
+      update_item(anime_id);
+    changed_items_.clear();
+  }
+}
+
+}  // namespace taiga
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -38,6 +40,10 @@ public:
   float CalculateScoreDeviation();
   const std::vector<float>& CalculateScoreDistribution();
 
+  void InvalidateItem(int anime_id);
+  void InvalidateItems();
+  void InvalidateLocalData();
+
 public:
   int anime_count;
   int connections_failed;
@@ -55,6 +61,29 @@ public:
   unsigned int torrent_count;
   unsigned long long torrent_size;
   int uptime;
+
+private:
+  // Values that an item contributes to the totals below
+  struct ItemValues {
+    int episodes = 0;
+    int score = 0;
+    int seconds_planned = 0;
+    int seconds_spent = 0;
+  };
+
+  void AddItemValues(const ItemValues& values, int sign);
+  void UpdateItems();
+
+  std::map<int, ItemValues> item_values_;
+  std::set<int> changed_items_;
+  bool items_changed_;
+  bool local_data_changed_;
+
+  int items_scored_;
+  int seconds_planned_;
+  int seconds_spent_;
+  double sum_scores_;
+  double sum_squares_;
 };
 
 }  // namespace taiga
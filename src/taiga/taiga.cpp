@@ -31,6 +31,7 @@
 #include "taiga/taiga.h"
 #include "taiga/version.h"
 #include "track/media.h"
+#include "track/recognition.h"
 #include "ui/dialog.h"
 #include "ui/menu.h"
 #include "ui/theme.h"
@@ -125,7 +126,9 @@ void App::Uninitialize() {
   // Save
   Settings.Save();
   AnimeDatabase.SaveDatabase();
+  History.Save();  // Compacts the journal
   Aggregator.SaveArchive();
+  Meow.SaveCache();
 
   // Exit
   PostQuitMessage();
@@ -91,6 +91,7 @@ void Timer::OnTimeout() {
       break;
 
     case kTimerMemory:
+      ConnectionManager.FlushCache();
       ConnectionManager.FreeMemory();
       ImageDatabase.FreeMemory();
       break;
@@ -71,7 +71,7 @@ void UpdateHelper::CheckAnimeRelations() {
                                 taiga::kHttpTaigaUpdateRelations);
 }
 
-bool UpdateHelper::ParseData(std::wstring data) {
+bool UpdateHelper::ParseData(const std::string& data) {
   items.clear();
   download_path_.clear();
   current_item_.reset();
@@ -81,7 +81,8 @@ bool UpdateHelper::ParseData(std::wstring data) {
   update_available_ = false;
 
   xml_document document;
-  xml_parse_result parse_result = document.load_string(data.c_str());
+  xml_parse_result parse_result = document.load_buffer(
+      data.data(), data.size(), pugi::parse_default, pugi::encoding_utf8);
 
   if (parse_result.status != pugi::status_ok)
     return false;
@@ -39,7 +39,7 @@ public:
   bool IsNewSeasonAvailable() const;
   bool IsRestartRequired() const;
   bool IsUpdateAvailable() const;
-  bool ParseData(std::wstring data);
+  bool ParseData(const std::string& data);
   bool RunInstaller();
 
   std::wstring GetCurrentAnimeRelationsModified() const;
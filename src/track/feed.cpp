@@ -158,11 +158,12 @@ bool Feed::Load() {
   return true;
 }
 
-bool Feed::Load(const std::wstring& data) {
+bool Feed::Load(const std::string& data) {
   items.clear();
 
   xml_document document;
-  xml_parse_result parse_result = document.load_string(data.c_str());
+  xml_parse_result parse_result = document.load_buffer(
+      data.data(), data.size(), pugi::parse_default, pugi::encoding_utf8);
 
   if (parse_result.status != pugi::status_ok)
     return false;
@@ -19,8 +19,10 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/optional.h"
@@ -135,7 +137,7 @@ public:
 
   std::wstring GetDataPath();
   bool Load();
-  bool Load(const std::wstring& data);
+  bool Load(const std::string& data);
 
   FeedCategory category;
   FeedSource source;
@@ -156,9 +158,9 @@ public:
   bool CheckFeed(FeedCategory category, const std::wstring& source, bool automatic = false);
   bool Download(FeedCategory category, const FeedItem* feed_item);
 
-  void HandleFeedCheck(Feed& feed, const std::string& data, bool automatic);
-  void HandleFeedDownload(Feed& feed, const std::string& data);
-  void HandleFeedDownloadError(Feed& feed);
+  void HandleFeedCheck(Feed& feed, const std::string& data, bool automatic, bool modified = true);
+  void HandleFeedDownload(Feed& feed, const std::wstring& uid, const std::string& data);
+  void HandleFeedDownloadError(Feed& feed, const std::wstring& uid);
   bool ValidateFeedDownload(const HttpRequest& http_request, HttpResponse& http_response);
 
   void FindFeedSource(Feed& feed) const;
@@ -168,7 +170,7 @@ public:
 
   size_t GetArchiveSize() const;
   bool LoadArchive();
-  bool SaveArchive() const;
+  bool SaveArchive();
   void AddToArchive(const std::wstring& file);
   void ClearArchive();
   bool SearchArchive(const std::wstring& file) const;
@@ -176,14 +178,39 @@ public:
   FeedFilterManager filter_manager;
 
 private:
+  struct FeedDownload {
+    enum class State {
+      Queued,
+      Downloading,
+      Finished,
+      Failed,
+    };
+    std::wstring link;
+    std::wstring uid;
+    std::string data;
+    State state = State::Queued;
+  };
+
   bool CompareFeedItems(const GenericFeedItem& item1, const GenericFeedItem& item2);
   FeedItem* FindFeedItemByLink(Feed& feed, const std::wstring& link);
+  FeedDownload* FindFeedDownload(const std::wstring& uid);
+  void FinishFeedDownload(Feed& feed, const FeedDownload& download);
   void HandleFeedDownloadOpen(FeedItem& feed_item, const std::wstring& file);
   bool IsMagnetLink(const FeedItem& feed_item) const;
+  void ProcessDownloadQueue(Feed& feed);
+
+  void TrimArchive();
 
-  std::vector<std::wstring> download_queue_;
+  // Downloads are started in parallel, but finished in the order they were
+  // queued
+  std::deque<FeedDownload> download_queue_;
   std::vector<Feed> feeds_;
-  std::vector<std::wstring> file_archive_;
+
+  // Archived file names in the order they were added, and a set of the same
+  // names for fast lookups
+  std::deque<std::wstring> file_archive_;
+  std::unordered_set<std::wstring> file_archive_set_;
+  bool file_archive_changed_ = false;
 };
 
 extern class Aggregator Aggregator;
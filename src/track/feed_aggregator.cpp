@@ -31,6 +31,7 @@
 #include "taiga/http.h"
 #include "taiga/path.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "track/feed.h"
 #include "track/recognition.h"
 #include "ui/dialog.h"
@@ -63,7 +64,7 @@ bool Aggregator::CheckFeed(FeedCategory category, const std::wstring& source,
 
   HttpRequest http_request;
   http_request.url = feed.link;
-  http_request.parameter = reinterpret_cast<LPARAM>(&feed);
+  http_request.parameter = reinterpret_cast<intptr_t>(&feed);
   http_request.header[L"Accept"] = L"application/rss+xml, */*";
   http_request.header[L"Accept-Encoding"] = L"gzip";
 
@@ -86,7 +87,10 @@ bool Aggregator::CheckFeed(FeedCategory category, const std::wstring& source,
 }
 
 void Aggregator::ExamineData(Feed& feed) {
-  for (auto& feed_item : feed.items) {
+  std::vector<std::wstring> titles;
+  titles.reserve(feed.items.size());
+
+  for (const auto& feed_item : feed.items) {
     auto title = feed_item.title;
     switch (feed.source) {
       case FeedSource::AnimeBytes: {
@@ -103,21 +107,26 @@ void Aggregator::ExamineData(Feed& feed) {
         break;
       }
     }
+    titles.push_back(title);
+  }
 
+  // Examine titles and compare with anime list items
+  static track::recognition::ParseOptions parse_options;
+  parse_options.parse_path = false;
+  parse_options.streaming_media = false;
+  static track::recognition::MatchOptions match_options;
+  match_options.allow_sequels = true;
+  match_options.check_airing_date = true;
+  match_options.check_anime_type = true;
+  match_options.check_episode_number = true;
+  match_options.streaming_media = false;
+  std::vector<anime::Episode> episodes;
+  Meow.IdentifyBatch(titles, parse_options, match_options, episodes);
+
+  for (size_t i = 0; i < feed.items.size(); ++i) {
+    auto& feed_item = feed.items.at(i);
     auto& episode_data = feed_item.episode_data;
-
-    // Examine title and compare with anime list items
-    static track::recognition::ParseOptions parse_options;
-    parse_options.parse_path = false;
-    parse_options.streaming_media = false;
-    Meow.Parse(title, parse_options, episode_data);
-    static track::recognition::MatchOptions match_options;
-    match_options.allow_sequels = true;
-    match_options.check_airing_date = true;
-    match_options.check_anime_type = true;
-    match_options.check_episode_number = true;
-    match_options.streaming_media = false;
-    Meow.Identify(episode_data, false, match_options);
+    static_cast<anime::Episode&>(episode_data) = episodes.at(i);
 
     // Update last aired episode number
     if (anime::IsValidId(episode_data.anime_id)) {
@@ -147,73 +156,125 @@ void Aggregator::ExamineData(Feed& feed) {
 bool Aggregator::Download(FeedCategory category, const FeedItem* feed_item) {
   Feed& feed = *GetFeed(category);
 
+  auto add_to_queue = [this](const std::wstring& link) {
+    FeedDownload download;
+    download.link = link;
+    download_queue_.push_back(download);
+  };
+
   if (feed_item) {
-    download_queue_.push_back(feed_item->link);
-    feed_item = nullptr;
+    add_to_queue(feed_item->link);
   } else if (download_queue_.empty()) {
-    std::vector<const FeedItem*> selected_feed_items;
+    // Sort keys are calculated only once for each item
+    const auto sort_by = Settings[taiga::kTorrent_Download_SortBy];
+    const bool descending =
+        Settings[taiga::kTorrent_Download_SortOrder] == L"descending";
+
+    struct SortItem {
+      const FeedItem* feed_item;
+      int anime_id;
+      time_t key;
+    };
+    std::vector<SortItem> selected_feed_items;
+
     for (const auto& item : feed.items) {
-      if (item.state == FeedItemState::Selected)
-        selected_feed_items.push_back(&item);
+      if (item.state != FeedItemState::Selected)
+        continue;
+      time_t key = 0;
+      if (sort_by == L"episode_number") {
+        key = item.episode_data.episode_number();
+      } else if (sort_by == L"release_date") {
+        key = ConvertRfc822(item.pub_date);
+      }
+      selected_feed_items.push_back({&item, item.episode_data.anime_id, key});
     }
+
     std::sort(selected_feed_items.begin(), selected_feed_items.end(),
-        [&](const FeedItem* item1, const FeedItem* item2) {
-          if (item1->episode_data.anime_id != item2->episode_data.anime_id)
-            return item1->episode_data.anime_id < item2->episode_data.anime_id;
-          auto sort_by = Settings[taiga::kTorrent_Download_SortBy];
-          auto sort_order = Settings[taiga::kTorrent_Download_SortOrder];
-          if (sort_by == L"episode_number") {
-            if (sort_order == L"descending") {
-              return item2->episode_data.episode_number() <
-                     item1->episode_data.episode_number();
-            } else {
-              return item1->episode_data.episode_number() <
-                     item2->episode_data.episode_number();
-            }
-          } else if (sort_by == L"release_date") {
-            if (sort_order == L"descending") {
-              return ConvertRfc822(item2->pub_date) <
-                     ConvertRfc822(item1->pub_date);
-            } else {
-              return ConvertRfc822(item1->pub_date) <
-                     ConvertRfc822(item2->pub_date);
-            }
-          } else {
-            return false;
-          }
+        [&descending](const SortItem& item1, const SortItem& item2) {
+          if (item1.anime_id != item2.anime_id)
+            return item1.anime_id < item2.anime_id;
+          return descending ? item2.key < item1.key : item1.key < item2.key;
         });
+
     for (const auto& item : selected_feed_items) {
-      download_queue_.push_back(item->link);
+      add_to_queue(item.feed_item->link);
     }
   }
 
-  while (!feed_item && !download_queue_.empty()) {
-    feed_item = FindFeedItemByLink(feed, download_queue_.front());
-    if (!feed_item)
-      download_queue_.erase(download_queue_.begin());
-  }
-
-  if (!feed_item)
+  if (download_queue_.empty())
     return false;
 
-  if (IsMagnetLink(*feed_item)) {
-    ui::ChangeStatusText(L"Opening magnet link for \"" + feed_item->title + L"\"...");
-    const std::string empty_data;
-    HandleFeedDownload(feed, empty_data);
+  ProcessDownloadQueue(feed);
+
+  return true;
+}
+
+void Aggregator::ProcessDownloadQueue(Feed& feed) {
+  using State = FeedDownload::State;
+
+  size_t max_parallel = Settings.GetInt(taiga::kTorrent_Download_MaxParallel);
+  max_parallel = std::max(max_parallel, static_cast<size_t>(1));
 
-  } else {
-    ui::ChangeStatusText(L"Downloading \"" + feed_item->title + L"\"...");
-    ui::EnableDialogInput(ui::Dialog::Torrents, false);
+  while (!download_queue_.empty()) {
+    // Finish downloads in the order they were queued
+    while (!download_queue_.empty()) {
+      const auto& download = download_queue_.front();
+      if (download.state == State::Finished) {
+        FinishFeedDownload(feed, download);
+      } else if (download.state != State::Failed) {
+        break;
+      }
+      download_queue_.pop_front();
+    }
+
+    // Start new downloads
+    size_t active_count = std::count_if(
+        download_queue_.begin(), download_queue_.end(),
+        [](const FeedDownload& download) {
+          return download.state == State::Downloading;
+        });
+
+    for (auto& download : download_queue_) {
+      if (active_count >= max_parallel)
+        break;
+      if (download.state != State::Queued)
+        continue;
+
+      const auto feed_item = FindFeedItemByLink(feed, download.link);
+
+      if (!feed_item) {
+        download.state = State::Failed;
 
-    HttpRequest http_request;
-    http_request.header[L"Accept"] = L"application/x-bittorrent, */*";
-    http_request.url = feed_item->link;
-    http_request.parameter = reinterpret_cast<LPARAM>(&feed);
+      } else if (IsMagnetLink(*feed_item)) {
+        ui::ChangeStatusText(L"Opening magnet link for \"" + feed_item->title + L"\"...");
+        download.state = State::Finished;
 
-    ConnectionManager.MakeRequest(http_request, taiga::kHttpFeedDownload);
+      } else {
+        ui::ChangeStatusText(L"Downloading \"" + feed_item->title + L"\"...");
+        ui::EnableDialogInput(ui::Dialog::Torrents, false);
+
+        HttpRequest http_request;
+        http_request.header[L"Accept"] = L"application/x-bittorrent, */*";
+        http_request.url = feed_item->link;
+        http_request.parameter = reinterpret_cast<intptr_t>(&feed);
+
+        download.uid = http_request.uid;
+        download.state = State::Downloading;
+        active_count++;
+
+        ConnectionManager.MakeRequest(http_request, taiga::kHttpFeedDownload);
+      }
+    }
+
+    // Repeat if there are items that we can finish right away
+    if (download_queue_.empty() ||
+        (download_queue_.front().state != State::Finished &&
+         download_queue_.front().state != State::Failed))
+      break;
   }
 
-  return true;
+  if (download_queue_.empty())
+    SaveArchive();  // Save once for all items in the queue
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -228,11 +289,20 @@ FeedItem* Aggregator::FindFeedItemByLink(Feed& feed, const std::wstring& link) {
 }
 
 void Aggregator::HandleFeedCheck(Feed& feed, const std::string& data,
-                                 bool automatic) {
+                                 bool automatic, bool modified) {
+  // Items of an unchanged feed were already examined, and there's nothing new
+  // to notify about or download
+  if (automatic && !modified && !feed.items.empty()) {
+    LOGD(L"Feed is unchanged: {}", feed.link);
+    ui::OnFeedCheck(false);
+    return;
+  }
+
   std::wstring file = feed.GetDataPath() + L"feed.xml";
   SaveToFile(data, file);
+  Stats.InvalidateLocalData();
 
-  feed.Load(StrToWstr(data));
+  feed.Load(data);
   ExamineData(feed);
   download_queue_.clear();
 
@@ -258,25 +328,54 @@ void Aggregator::HandleFeedCheck(Feed& feed, const std::string& data,
   }
 }
 
-void Aggregator::HandleFeedDownload(Feed& feed, const std::string& data) {
-  FeedItem* feed_item = nullptr;
+void Aggregator::HandleFeedDownload(Feed& feed, const std::wstring& uid,
+                                    const std::string& data) {
+  auto download = FindFeedDownload(uid);
+
+  if (!download)
+    return;
+
+  download->data = data;
+  download->state = FeedDownload::State::Finished;
+
+  ProcessDownloadQueue(feed);
+}
+
+void Aggregator::HandleFeedDownloadError(Feed& feed, const std::wstring& uid) {
+  auto download = FindFeedDownload(uid);
 
-  if (!download_queue_.empty()) {
-    feed_item = FindFeedItemByLink(feed, download_queue_.front());
-    download_queue_.erase(download_queue_.begin());
+  if (!download)
+    return;
+
+  download->state = FeedDownload::State::Failed;
+
+  ProcessDownloadQueue(feed);
+}
+
+Aggregator::FeedDownload* Aggregator::FindFeedDownload(const std::wstring& uid) {
+  for (auto& download : download_queue_) {
+    if (download.uid == uid)
+      return &download;
   }
 
+  return nullptr;
+}
+
+void Aggregator::FinishFeedDownload(Feed& feed, const FeedDownload& download) {
+  FeedItem* feed_item = FindFeedItemByLink(feed, download.link);
+
   if (!feed_item)
     return;
 
   std::wstring file;
 
-  if (!data.empty()) {
+  if (!download.data.empty()) {
     file = feed_item->title;
     ValidateFileName(file);
     file = feed.GetDataPath() + file + L".torrent";
 
-    SaveToFile(data, file);
+    SaveToFile(download.data, file);
+    Stats.InvalidateLocalData();
 
     if (!FileExists(file)) {
       ui::OnFeedDownloadError(L"Torrent file doesn't exist");
@@ -293,19 +392,9 @@ void Aggregator::HandleFeedDownload(Feed& feed, const std::string& data) {
 
   feed_item->state = FeedItemState::DiscardedNormal;
   AddToArchive(feed_item->title);
-  SaveArchive();
   ui::OnFeedDownloadSuccess(is_magnet_link);
 
   HandleFeedDownloadOpen(*feed_item, file);
-
-  if (!download_queue_.empty())
-    Download(feed.category, nullptr);
-}
-
-void Aggregator::HandleFeedDownloadError(Feed& feed) {
-  if (!download_queue_.empty()) {
-    download_queue_.erase(download_queue_.begin());
-  }
 }
 
 std::wstring GetTorrentApplicationPath() {
@@ -425,7 +514,7 @@ bool Aggregator::ValidateFeedDownload(const HttpRequest& http_request,
   }
 
   // Check response body
-  if (StartsWith(http_response.body, L"<!DOCTYPE html>")) {
+  if (StartsWith(http_response.body, "<!DOCTYPE html>")) {
     const auto location = http_request.url.Build();
     ui::OnFeedDownloadError(L"Invalid torrent file: " + location);
     return false;
@@ -564,46 +653,71 @@ bool Aggregator::LoadArchive() {
     return false;
 
   // Read discarded
-  file_archive_.clear();
+  ClearArchive();
   xml_node archive_node = document.child(L"archive");
   foreach_xmlnode_(node, archive_node, L"item") {
-    file_archive_.push_back(node.attribute(L"title").value());
+    AddToArchive(node.attribute(L"title").value());
   }
+  file_archive_changed_ = false;
 
   return true;
 }
 
-bool Aggregator::SaveArchive() const {
+bool Aggregator::SaveArchive() {
+  // Items are often added in batches, so there may be nothing left to save
+  if (!file_archive_changed_)
+    return true;
+
+  TrimArchive();
+
   xml_document document;
   xml_node archive_node = document.append_child(L"archive");
 
   size_t max_count = Settings.GetInt(taiga::kTorrent_Filter_ArchiveMaxCount);
 
   if (max_count > 0) {
-    size_t length = file_archive_.size();
-    size_t i = 0;
-    if (length > max_count)
-      i = length - max_count;
-    for ( ; i < file_archive_.size(); i++) {
+    for (const auto& file : file_archive_) {
       xml_node xml_item = archive_node.append_child(L"item");
-      xml_item.append_attribute(L"title") = file_archive_[i].c_str();
+      xml_item.append_attribute(L"title") = file.c_str();
     }
   }
 
   std::wstring path = taiga::GetPath(taiga::Path::FeedHistory);
-  return XmlWriteDocumentToFile(document, path);
+  if (!XmlWriteDocumentToFile(document, path))
+    return false;
+
+  file_archive_changed_ = false;
+  return true;
 }
 
 void Aggregator::AddToArchive(const std::wstring& file) {
-  if (!SearchArchive(file))
+  if (file_archive_set_.insert(file).second) {
     file_archive_.push_back(file);
+    file_archive_changed_ = true;
+    TrimArchive();
+  }
 }
 
 void Aggregator::ClearArchive() {
   file_archive_.clear();
+  file_archive_set_.clear();
+  file_archive_changed_ = true;
 }
 
 bool Aggregator::SearchArchive(const std::wstring& file) const {
-  auto it = std::find(file_archive_.begin(), file_archive_.end(), file);
-  return it != file_archive_.end();
+  return file_archive_set_.count(file) > 0;
+}
+
+void Aggregator::TrimArchive() {
+  const size_t max_count =
+      Settings.GetInt(taiga::kTorrent_Filter_ArchiveMaxCount);
+
+  // Older items are removed first (0 means that nothing is saved to disk, but
+  // we still keep the items in memory for the current session)
+  if (max_count > 0) {
+    while (file_archive_.size() > max_count) {
+      file_archive_set_.erase(file_archive_.front());
+      file_archive_.pop_front();
+    }
+  }
 }
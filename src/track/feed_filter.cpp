@@ -16,6 +16,8 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "base/file.h"
 #include "base/foreach.h"
 #include "base/log.h"
@@ -30,183 +32,126 @@
 #include "track/feed.h"
 #include "track/feed_filter.h"
 
-bool EvaluateCondition(const FeedFilterCondition& condition,
-                       const FeedItem& item) {
-  bool is_numeric = false;
-  std::wstring element;
-  std::wstring value = ReplaceVariables(condition.value, item.episode_data);
-  auto anime = AnimeDatabase.FindItem(item.episode_data.anime_id);
+static bool IsNumericElement(FeedFilterElement element) {
+  switch (element) {
+    case kFeedFilterElement_File_Size:
+    case kFeedFilterElement_Meta_Id:
+    case kFeedFilterElement_Meta_Episodes:
+    case kFeedFilterElement_Meta_Status:
+    case kFeedFilterElement_Meta_Type:
+    case kFeedFilterElement_User_Status:
+    case kFeedFilterElement_Episode_Number:
+    case kFeedFilterElement_Episode_Version:
+    case kFeedFilterElement_Local_EpisodeAvailable:
+      return true;
+    default:
+      return false;
+  }
+}
 
-  switch (condition.element) {
+// Returns false if the element has no value (e.g. when the anime is unknown)
+static bool GetNumericElement(FeedFilterElement element, const FeedItem& item,
+                              const anime::Item* anime, int& number) {
+  switch (element) {
+    case kFeedFilterElement_Meta_Id:
+      number = anime ? anime->GetId() : anime::ID_UNKNOWN;
+      return true;
+    case kFeedFilterElement_Meta_Episodes:
+      if (!anime)
+        return false;
+      number = anime->GetEpisodeCount();
+      return true;
+    case kFeedFilterElement_Meta_Status:
+      number = anime ? anime->GetAiringStatus() : anime::kUnknownStatus;
+      return true;
+    case kFeedFilterElement_Meta_Type:
+      number = anime ? anime->GetType() : anime::kUnknownType;
+      return true;
+    case kFeedFilterElement_User_Status:
+      number = anime ? anime->GetMyStatus() : anime::kNotInList;
+      return true;
+    case kFeedFilterElement_Episode_Number:
+      if (!item.episode_data.episode_number()) {
+        if (!anime)
+          return false;
+        number = anime->GetEpisodeCount();
+      } else {
+        number = anime::GetEpisodeHigh(item.episode_data);
+      }
+      return true;
+    case kFeedFilterElement_Episode_Version:
+      number = item.episode_data.release_version();  // defaults to 1
+      return true;
+    case kFeedFilterElement_Local_EpisodeAvailable:
+      if (!anime)
+        return false;
+      number = anime->IsEpisodeAvailable(
+          anime::GetEpisodeHigh(item.episode_data));
+      return true;
+  }
+
+  return false;
+}
+
+static std::wstring GetElement(FeedFilterElement element, const FeedItem& item,
+                               const anime::Item* anime) {
+  switch (element) {
     case kFeedFilterElement_File_Title:
-      element = item.title;
-      break;
+      return item.title;
     case kFeedFilterElement_File_Category:
-      element = TranslateTorrentCategory(item.torrent_category);
-      break;
+      return TranslateTorrentCategory(item.torrent_category);
     case kFeedFilterElement_File_Description:
-      element = item.description;
-      break;
+      return item.description;
     case kFeedFilterElement_File_Link:
-      element = item.link;
-      break;
+      return item.link;
     case kFeedFilterElement_File_Size:
-      element = ToWstr(item.file_size);
-      is_numeric = true;
-      break;
-    case kFeedFilterElement_Meta_Id:
-      element = ToWstr(anime ? anime->GetId() : anime::ID_UNKNOWN);
-      is_numeric = true;
-      break;
+      return ToWstr(item.file_size);
     case kFeedFilterElement_Episode_Title:
-      element = item.episode_data.anime_title();
-      break;
+      return item.episode_data.anime_title();
     case kFeedFilterElement_Meta_DateStart:
       if (anime)
-        element = anime->GetDateStart().to_string();
+        return anime->GetDateStart().to_string();
       break;
     case kFeedFilterElement_Meta_DateEnd:
       if (anime)
-        element = anime->GetDateEnd().to_string();
-      break;
-    case kFeedFilterElement_Meta_Episodes:
-      if (anime)
-        element = ToWstr(anime->GetEpisodeCount());
-      is_numeric = true;
-      break;
-    case kFeedFilterElement_Meta_Status:
-      element = ToWstr(anime ? anime->GetAiringStatus() : anime::kUnknownStatus);
-      is_numeric = true;
-      break;
-    case kFeedFilterElement_Meta_Type:
-      element = ToWstr(anime ? anime->GetType() : anime::kUnknownType);
-      is_numeric = true;
-      break;
-    case kFeedFilterElement_User_Status:
-      element = ToWstr(anime ? anime->GetMyStatus() : anime::kNotInList);
-      is_numeric = true;
+        return anime->GetDateEnd().to_string();
       break;
     case kFeedFilterElement_User_Tags:
       if (anime)
-        element = anime->GetMyTags();
-      break;
-    case kFeedFilterElement_Episode_Number:
-      if (!item.episode_data.episode_number()) {
-        element = anime ? ToWstr(anime->GetEpisodeCount()) : L"";
-      } else {
-        element = ToWstr(anime::GetEpisodeHigh(item.episode_data));
-      }
-      is_numeric = true;
-      break;
-    case kFeedFilterElement_Episode_Version:
-      element = ToWstr(item.episode_data.release_version());  // defaults to 1
-      is_numeric = true;
-      break;
-    case kFeedFilterElement_Local_EpisodeAvailable:
-      if (anime)
-        element = ToWstr(anime->IsEpisodeAvailable(
-            anime::GetEpisodeHigh(item.episode_data)));
-      is_numeric = true;
+        return anime->GetMyTags();
       break;
     case kFeedFilterElement_Episode_Group:
-      element = item.episode_data.release_group();
-      break;
+      return item.episode_data.release_group();
     case kFeedFilterElement_Episode_VideoResolution:
-      element = item.episode_data.video_resolution();
-      break;
+      return item.episode_data.video_resolution();
     case kFeedFilterElement_Episode_VideoType:
-      element = item.episode_data.video_terms();
+      return item.episode_data.video_terms();
+    default: {
+      int number = 0;
+      if (GetNumericElement(element, item, anime, number))
+        return ToWstr(number);
       break;
+    }
   }
 
-  if (element.empty() || value.empty())
-    is_numeric = false;
+  return std::wstring();
+}
 
-  switch (condition.op) {
+template <typename T>
+static bool CompareValues(FeedFilterOperator op, const T& a, const T& b) {
+  switch (op) {
     case kFeedFilterOperator_Equals:
-      if (is_numeric) {
-        if (condition.element == kFeedFilterElement_File_Size)
-          return ToUint64(element) == ParseSizeString(value);
-        if (IsEqual(value, L"True"))
-          return ToInt(element) == TRUE;
-        return ToInt(element) == ToInt(value);
-      } else {
-        if (condition.element == kFeedFilterElement_Episode_VideoResolution) {
-          return anime::TranslateResolution(element) == anime::TranslateResolution(condition.value);
-        } else {
-          return IsEqual(element, value);
-        }
-      }
+      return a == b;
     case kFeedFilterOperator_NotEquals:
-      if (is_numeric) {
-        if (condition.element == kFeedFilterElement_File_Size)
-          return ToUint64(element) != ParseSizeString(value);
-        if (IsEqual(value, L"True"))
-          return ToInt(element) == TRUE;
-        return ToInt(element) != ToInt(value);
-      } else {
-        if (condition.element == kFeedFilterElement_Episode_VideoResolution) {
-          return anime::TranslateResolution(element) != anime::TranslateResolution(condition.value);
-        } else {
-          return !IsEqual(element, value);
-        }
-      }
+      return a != b;
     case kFeedFilterOperator_IsGreaterThan:
-      if (is_numeric) {
-        if (condition.element == kFeedFilterElement_File_Size)
-          return ToUint64(element) > ParseSizeString(value);
-        return ToInt(element) > ToInt(value);
-      } else {
-        if (condition.element == kFeedFilterElement_Episode_VideoResolution) {
-          return anime::TranslateResolution(element) > anime::TranslateResolution(condition.value);
-        } else {
-          return CompareStrings(element, condition.value) > 0;
-        }
-      }
+      return a > b;
     case kFeedFilterOperator_IsGreaterThanOrEqualTo:
-      if (is_numeric) {
-        if (condition.element == kFeedFilterElement_File_Size)
-          return ToUint64(element) >= ParseSizeString(value);
-        return ToInt(element) >= ToInt(value);
-      } else {
-        if (condition.element == kFeedFilterElement_Episode_VideoResolution) {
-          return anime::TranslateResolution(element) >= anime::TranslateResolution(condition.value);
-        } else {
-          return CompareStrings(element, condition.value) >= 0;
-        }
-      }
+      return a >= b;
     case kFeedFilterOperator_IsLessThan:
-      if (is_numeric) {
-        if (condition.element == kFeedFilterElement_File_Size)
-          return ToUint64(element) < ParseSizeString(value);
-        return ToInt(element) < ToInt(value);
-      } else {
-        if (condition.element == kFeedFilterElement_Episode_VideoResolution) {
-          return anime::TranslateResolution(element) < anime::TranslateResolution(condition.value);
-        } else {
-          return CompareStrings(element, condition.value) < 0;
-        }
-      }
+      return a < b;
     case kFeedFilterOperator_IsLessThanOrEqualTo:
-      if (is_numeric) {
-        if (condition.element == kFeedFilterElement_File_Size)
-          return ToUint64(element) <= ParseSizeString(value);
-        return ToInt(element) <= ToInt(value);
-      } else {
-        if (condition.element == kFeedFilterElement_Episode_VideoResolution) {
-          return anime::TranslateResolution(element) <= anime::TranslateResolution(condition.value);
-        } else {
-          return CompareStrings(element, condition.value) <= 0;
-        }
-      }
-    case kFeedFilterOperator_BeginsWith:
-      return StartsWith(element, value);
-    case kFeedFilterOperator_EndsWith:
-      return EndsWith(element, value);
-    case kFeedFilterOperator_Contains:
-      return InStr(element, value, 0, true) > -1;
-    case kFeedFilterOperator_NotContains:
-      return InStr(element, value, 0, true) == -1;
+      return a <= b;
   }
 
   return false;
@@ -216,7 +161,12 @@ bool EvaluateCondition(const FeedFilterCondition& condition,
 
 FeedFilterCondition::FeedFilterCondition()
     : element(kFeedFilterElement_Meta_Id),
-      op(kFeedFilterOperator_Equals) {
+      op(kFeedFilterOperator_Equals),
+      is_constant_(false),
+      constant_value_is_true_(false),
+      constant_value_number_(0),
+      constant_value_size_(0),
+      value_resolution_(0) {
 }
 
 FeedFilterCondition& FeedFilterCondition::operator=(const FeedFilterCondition& condition) {
@@ -227,6 +177,98 @@ FeedFilterCondition& FeedFilterCondition::operator=(const FeedFilterCondition& c
   return *this;
 }
 
+void FeedFilterCondition::Compile() {
+  is_constant_ = !HasScriptVariables(value);
+
+  if (is_constant_) {
+    constant_value_ = ReplaceVariables(value, anime::Episode());
+    constant_value_is_true_ = IsEqual(constant_value_, L"True");
+    constant_value_number_ = ToInt(constant_value_);
+    constant_value_size_ = ParseSizeString(constant_value_);
+  } else {
+    constant_value_.clear();
+  }
+
+  value_resolution_ = anime::TranslateResolution(value);
+}
+
+bool FeedFilterCondition::Evaluate(const FeedItem& item,
+                                   const anime::Item* anime) const {
+  std::wstring replaced_value;
+  if (!is_constant_)
+    replaced_value = ReplaceVariables(value, item.episode_data);
+  const std::wstring& current_value =
+      is_constant_ ? constant_value_ : replaced_value;
+
+  switch (op) {
+    case kFeedFilterOperator_BeginsWith:
+      return StartsWith(GetElement(element, item, anime), current_value);
+    case kFeedFilterOperator_EndsWith:
+      return EndsWith(GetElement(element, item, anime), current_value);
+    case kFeedFilterOperator_Contains:
+      return InStr(GetElement(element, item, anime), current_value, 0, true) > -1;
+    case kFeedFilterOperator_NotContains:
+      return InStr(GetElement(element, item, anime), current_value, 0, true) == -1;
+  }
+
+  // Numeric elements are compared as numbers, unless either side is empty
+  if (IsNumericElement(element) && !current_value.empty()) {
+    if (element == kFeedFilterElement_File_Size) {
+      const uint64_t size = is_constant_ ?
+          constant_value_size_ : ParseSizeString(current_value);
+      return CompareValues<uint64_t>(op, item.file_size, size);
+    }
+    int number = 0;
+    if (GetNumericElement(element, item, anime, number)) {
+      const bool value_is_true = is_constant_ ?
+          constant_value_is_true_ : IsEqual(current_value, L"True");
+      switch (op) {
+        case kFeedFilterOperator_Equals:
+        case kFeedFilterOperator_NotEquals:
+          if (value_is_true)
+            return number == TRUE;
+          break;
+      }
+      return CompareValues<int>(op, number,
+          is_constant_ ? constant_value_number_ : ToInt(current_value));
+    }
+  }
+
+  const std::wstring element_value = GetElement(element, item, anime);
+
+  if (element == kFeedFilterElement_Episode_VideoResolution) {
+    return CompareValues<int>(op, anime::TranslateResolution(element_value),
+                              value_resolution_);
+  }
+
+  switch (op) {
+    case kFeedFilterOperator_Equals:
+      return IsEqual(element_value, current_value);
+    case kFeedFilterOperator_NotEquals:
+      return !IsEqual(element_value, current_value);
+    default:
+      return CompareValues<int>(op, CompareStrings(element_value, value), 0);
+  }
+}
+
+int FeedFilterCondition::GetCost() const {
+  int cost = 0;
+
+  // Replacing variables and searching within strings are the most expensive
+  if (!is_constant_)
+    cost += 4;
+  switch (op) {
+    case kFeedFilterOperator_Contains:
+    case kFeedFilterOperator_NotContains:
+      cost += 2;
+      break;
+  }
+  if (!IsNumericElement(element))
+    cost += 1;
+
+  return cost;
+}
+
 void FeedFilterCondition::Reset() {
   element = kFeedFilterElement_File_Title;
   op = kFeedFilterOperator_Equals;
@@ -260,6 +302,22 @@ FeedFilter& FeedFilter::operator=(const FeedFilter& filter) {
   return *this;
 }
 
+void FeedFilter::Compile() {
+  for (auto& condition : conditions)
+    condition.Compile();
+
+  condition_order_.resize(conditions.size());
+  for (size_t i = 0; i < condition_order_.size(); ++i)
+    condition_order_[i] = i;
+
+  // Evaluating cheaper conditions first lets us skip the expensive ones more
+  // often, and the result does not depend on the order
+  std::stable_sort(condition_order_.begin(), condition_order_.end(),
+      [this](size_t a, size_t b) {
+        return conditions[a].GetCost() < conditions[b].GetCost();
+      });
+}
+
 void FeedFilter::AddCondition(FeedFilterElement element,
                               FeedFilterOperator op,
                               const std::wstring& value) {
@@ -289,14 +347,19 @@ bool FeedFilter::Filter(Feed& feed, FeedItem& item, bool recursive) {
       return false;  // Filter doesn't apply to this item
   }
 
+  if (condition_order_.size() != conditions.size())
+    Compile();
+
+  const auto anime = AnimeDatabase.FindItem(item.episode_data.anime_id);
+
   bool matched = false;
   size_t condition_index = 0;  // Used only for debugging purposes
 
   switch (match) {
     case kFeedFilterMatchAll:
       matched = true;
-      for (size_t i = 0; i < conditions.size(); i++) {
-        if (!EvaluateCondition(conditions.at(i), item)) {
+      for (const auto i : condition_order_) {
+        if (!conditions.at(i).Evaluate(item, anime)) {
           matched = false;
           condition_index = i;
           break;
@@ -305,8 +368,8 @@ bool FeedFilter::Filter(Feed& feed, FeedItem& item, bool recursive) {
       break;
     case kFeedFilterMatchAny:
       matched = false;
-      for (size_t i = 0; i < conditions.size(); i++) {
-        if (EvaluateCondition(conditions.at(i), item)) {
+      for (const auto i : condition_order_) {
+        if (conditions.at(i).Evaluate(item, anime)) {
           matched = true;
           condition_index = i;
           break;
@@ -379,8 +442,11 @@ bool FeedFilter::Filter(Feed& feed, FeedItem& item, bool recursive) {
   return true;
 }
 
-bool FeedFilter::ApplyPreferenceFilter(Feed& feed, FeedItem& item) {
-  std::map<FeedFilterElement, bool> element_found;
+using preference_elements_t = std::map<FeedFilterElement, bool>;
+
+static preference_elements_t GetPreferenceElements(
+    const std::vector<FeedFilterCondition>& conditions) {
+  preference_elements_t element_found;
 
   for (const auto& condition : conditions) {
     switch (condition.element) {
@@ -393,9 +459,61 @@ bool FeedFilter::ApplyPreferenceFilter(Feed& feed, FeedItem& item) {
     }
   }
 
+  return element_found;
+}
+
+// Items that ApplyPreferenceFilter considers to be the same episode always have
+// the same key, although the opposite is not necessarily true
+static std::wstring GetPreferenceKey(const FeedItem& item,
+                                     preference_elements_t& element_found) {
+  // Compatible with IsEqual
+  auto normalize = [](std::wstring str) {
+    for (auto& c : str)
+      c = static_cast<wchar_t>(tolower(c));
+    return str;
+  };
+
+  std::wstring key;
+
+  const int anime_id = item.episode_data.anime_id;
+  if (!element_found[kFeedFilterElement_Meta_Id]) {
+    if (anime::IsValidId(anime_id)) {
+      key += L"#" + ToWstr(anime_id);
+    } else {
+      key += L"@";
+      if (!element_found[kFeedFilterElement_Episode_Title])
+        key += normalize(item.episode_data.anime_title());
+    }
+  }
+  key += L'\t';
+
+  if (!element_found[kFeedFilterElement_Episode_Number]) {
+    const auto range = item.episode_data.episode_number_range();
+    key += ToWstr(range.first) + L"-" + ToWstr(range.second);
+  }
+  key += L'\t';
+
+  if (!element_found[kFeedFilterElement_Episode_Group])
+    key += normalize(item.episode_data.release_group());
+
+  return key;
+}
+
+bool FeedFilter::ApplyPreferenceFilter(Feed& feed, FeedItem& item) {
+  auto element_found = GetPreferenceElements(conditions);
+
+  if (indexed_feed_ != &feed)
+    IndexFeedItems(feed);
+
   bool filter_applied = false;
 
-  for (auto& feed_item : feed.items) {
+  const auto it = indexed_items_.find(GetPreferenceKey(item, element_found));
+  if (it == indexed_items_.end())
+    return false;
+
+  for (const auto index : it->second) {
+    auto& feed_item = feed.items.at(index);
+
     // Do not bother if the item was discarded before
     if (feed_item.IsDiscarded())
       continue;
@@ -431,6 +549,23 @@ bool FeedFilter::ApplyPreferenceFilter(Feed& feed, FeedItem& item) {
   return filter_applied;
 }
 
+void FeedFilter::IndexFeedItems(const Feed& feed) {
+  auto element_found = GetPreferenceElements(conditions);
+
+  indexed_feed_ = &feed;
+  indexed_items_.clear();
+
+  for (size_t i = 0; i < feed.items.size(); ++i) {
+    const auto key = GetPreferenceKey(feed.items.at(i), element_found);
+    indexed_items_[key].push_back(i);
+  }
+}
+
+void FeedFilter::ClearFeedItemIndex() {
+  indexed_feed_ = nullptr;
+  indexed_items_.clear();
+}
+
 void FeedFilter::Reset() {
   enabled = true;
   action = kFeedFilterActionDiscard;
@@ -501,6 +636,15 @@ void FeedFilterManager::Filter(Feed& feed, bool preferences) {
   if (!Settings.GetBool(taiga::kTorrent_Filter_Enabled))
     return;
 
+  // Filters might have been edited since the last time
+  for (auto& filter : filters) {
+    if (preferences == (filter.action == kFeedFilterActionPrefer)) {
+      filter.Compile();
+      if (preferences)
+        filter.IndexFeedItems(feed);
+    }
+  }
+
   for (auto& item : feed.items) {
     for (auto& filter : filters) {
       if (preferences != (filter.action == kFeedFilterActionPrefer))
@@ -508,6 +652,9 @@ void FeedFilterManager::Filter(Feed& feed, bool preferences) {
       filter.Filter(feed, item, true);
     }
   }
+
+  for (auto& filter : filters)
+    filter.ClearFeedItemIndex();
 }
 
 void FeedFilterManager::FilterArchived(Feed& feed) {
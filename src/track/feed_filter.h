@@ -18,10 +18,14 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <string>
 #include <vector>
 
+namespace anime {
+class Item;
+}
 namespace pugi {
 class xml_node;
 }
@@ -100,12 +104,24 @@ public:
 
   FeedFilterCondition& operator=(const FeedFilterCondition& condition);
 
+  void Compile();
+  bool Evaluate(const FeedItem& item, const anime::Item* anime) const;
+  int GetCost() const;
   void Reset();
 
 public:
   FeedFilterElement element;
   FeedFilterOperator op;
   std::wstring value;
+
+private:
+  // Values that do not depend on the item are prepared before filtering
+  bool is_constant_;
+  std::wstring constant_value_;
+  bool constant_value_is_true_;
+  int constant_value_number_;
+  uint64_t constant_value_size_;
+  int value_resolution_;
 };
 
 class FeedFilter {
@@ -116,11 +132,14 @@ public:
   FeedFilter& operator=(const FeedFilter& filter);
 
   void AddCondition(FeedFilterElement element, FeedFilterOperator op, const std::wstring& value);
+  void Compile();
   bool Filter(Feed& feed, FeedItem& item, bool recursive);
   void Reset();
 
 public:
   bool ApplyPreferenceFilter(Feed& feed, FeedItem& item);
+  void IndexFeedItems(const Feed& feed);
+  void ClearFeedItemIndex();
 
   std::wstring name;
   bool enabled;
@@ -131,6 +150,15 @@ public:
 
   std::vector<int> anime_ids;
   std::vector<FeedFilterCondition> conditions;
+
+private:
+  // Indexes of conditions, ordered from the cheapest to evaluate
+  std::vector<size_t> condition_order_;
+
+  // Indexes of feed items, grouped by the values that a preference filter
+  // compares to find other releases of the same episode
+  const Feed* indexed_feed_ = nullptr;
+  std::map<std::wstring, std::vector<size_t>> indexed_items_;
 };
 
 class FeedFilterPreset {
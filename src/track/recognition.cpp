@@ -16,6 +16,10 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include <anitomy/anitomy/anitomy.h>
 #include <anitomy/anitomy/keyword.h>
 
@@ -33,6 +37,67 @@ track::recognition::Engine Meow;
 namespace track {
 namespace recognition {
 
+enum class ParserType {
+  Normal,
+  StreamingMedia,
+  DirectorySeason,
+  DirectoryTitle,
+  Count,
+};
+
+// Incremented whenever the parsers have to be configured again
+static std::atomic<unsigned int> parser_generation{0};
+
+static void ConfigureParsers(anitomy::Anitomy* parsers) {
+  for (size_t i = 0; i < static_cast<size_t>(ParserType::Count); ++i) {
+    parsers[i].options() = anitomy::Options();
+  }
+
+  auto& normal = parsers[static_cast<size_t>(ParserType::Normal)].options();
+  normal.ignored_strings = Settings.GetList(taiga::kRecognition_IgnoredStrings);
+
+  auto& streaming_media =
+      parsers[static_cast<size_t>(ParserType::StreamingMedia)].options();
+  streaming_media.allowed_delimiters = L" ";
+  streaming_media.ignored_strings = normal.ignored_strings;
+
+  auto& directory_season =
+      parsers[static_cast<size_t>(ParserType::DirectorySeason)].options();
+  directory_season.parse_episode_number = false;
+  directory_season.parse_episode_title = false;
+  directory_season.parse_file_extension = false;
+  directory_season.parse_release_group = false;
+
+  auto& directory_title =
+      parsers[static_cast<size_t>(ParserType::DirectoryTitle)].options();
+  directory_title.parse_episode_number = false;
+  directory_title.parse_episode_title = false;
+  directory_title.parse_file_extension = false;
+  directory_title.parse_release_group = true;
+}
+
+// Each thread keeps a configured parser of each type, which is reused until the
+// ignored strings are changed. Previous results are cleared on every parse.
+static anitomy::Anitomy& GetParser(ParserType type) {
+  struct ParserPool {
+    anitomy::Anitomy parsers[static_cast<size_t>(ParserType::Count)];
+    unsigned int generation = 0;
+    bool configured = false;
+  };
+  thread_local ParserPool pool;
+
+  const unsigned int generation = parser_generation;
+  if (!pool.configured || pool.generation != generation) {
+    ConfigureParsers(pool.parsers);
+    pool.generation = generation;
+    pool.configured = true;
+  }
+
+  return pool.parsers[static_cast<size_t>(type)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 bool Engine::Parse(std::wstring filename, const ParseOptions& parse_options,
                    anime::Episode& episode) const {
   // Clear previous data
@@ -49,13 +114,8 @@ bool Engine::Parse(std::wstring filename, const ParseOptions& parse_options,
   if (filename.empty())
     return false;
 
-  anitomy::Anitomy anitomy_instance;
-
-  // Set Anitomy options
-  if (parse_options.streaming_media)
-    anitomy_instance.options().allowed_delimiters = L" ";
-  Split(Settings[taiga::kRecognition_IgnoredStrings], L"|",
-        anitomy_instance.options().ignored_strings);
+  auto& anitomy_instance = GetParser(parse_options.streaming_media ?
+      ParserType::StreamingMedia : ParserType::Normal);
 
   if (!anitomy_instance.Parse(filename)) {
     LOGD(L"Could not parse filename: {}", filename);
@@ -70,11 +130,62 @@ bool Engine::Parse(std::wstring filename, const ParseOptions& parse_options,
   return true;
 }
 
+void Engine::InvalidateParsers() {
+  ++parser_generation;
+}
+
 int Engine::Identify(anime::Episode& episode, bool give_score,
                      const MatchOptions& match_options) {
-  std::set<int> anime_ids;
+  InitializeTitles();
+
+  sorted_scores_t scores;
+  const int anime_id = Identify(episode, give_score, match_options, scores);
+  scores_ = std::move(scores);
+
+  return anime_id;
+}
+
+void Engine::IdentifyBatch(const std::vector<std::wstring>& filenames,
+                           const ParseOptions& parse_options,
+                           const MatchOptions& match_options,
+                           std::vector<anime::Episode>& episodes) {
+  episodes.clear();
+  episodes.resize(filenames.size());
 
+  if (filenames.empty())
+    return;
+
+  // Titles must be ready before we start, as worker threads only read them
   InitializeTitles();
+  CheckCacheContext();
+
+  std::atomic<size_t> next_index{0};
+
+  auto process_items = [&]() {
+    sorted_scores_t scores;
+    for (size_t i = next_index++; i < filenames.size(); i = next_index++) {
+      Recognize(filenames.at(i), parse_options, match_options, episodes.at(i),
+                scores);
+    }
+  };
+
+  const size_t thread_count = std::min<size_t>(
+      filenames.size(), std::max(1u, std::thread::hardware_concurrency()));
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(process_items);
+  }
+  process_items();  // The calling thread does its share of the work too
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+int Engine::Identify(anime::Episode& episode, bool give_score,
+                     const MatchOptions& match_options,
+                     sorted_scores_t& scores) const {
+  std::set<int> anime_ids;
 
   auto valide_ids = [&](anime::Episode& episode) {
     for (auto it = anime_ids.begin(); it != anime_ids.end(); ) {
@@ -155,9 +266,9 @@ int Engine::Identify(anime::Episode& episode, bool give_score,
   } else if (anime_ids.size() == 1) {
     episode.anime_id = *anime_ids.begin();
   } else if (anime_ids.size() > 1) {
-    episode.anime_id = ScoreTitle(episode, anime_ids, match_options);
+    episode.anime_id = ScoreTitle(episode, anime_ids, match_options, scores);
   } else if (anime_ids.empty() && give_score) {
-    ScoreTitle(episode, anime_ids, match_options);
+    ScoreTitle(episode, anime_ids, match_options, scores);
   }
 
   // Post-processing
@@ -190,7 +301,10 @@ int Engine::Identify(anime::Episode& episode, bool give_score,
   return episode.anime_id;
 }
 
-bool Engine::Search(const std::wstring& title, std::vector<int>& anime_ids) {
+// Disabling the trigram index allows benchmarking it against a full scan of
+// the database, which should give the same results
+bool Engine::Search(const std::wstring& title, std::vector<int>& anime_ids,
+                    bool use_trigram_index) {
   anime::Episode episode;
   episode.set_anime_title(title);
 
@@ -199,7 +313,9 @@ bool Engine::Search(const std::wstring& title, std::vector<int>& anime_ids) {
 
   InitializeTitles();
 
-  ScoreTitle(episode, empty_set, default_options);
+  sorted_scores_t scores;
+  ScoreTitle(episode, empty_set, default_options, scores, use_trigram_index);
+  scores_ = std::move(scores);
 
   for (const auto& score : scores_) {
     anime_ids.push_back(score.first);
@@ -220,12 +336,32 @@ void Engine::InitializeTitles() {
     }
 
     ReadRelations();
+
+    LoadCache();
   }
 }
 
 void Engine::UpdateTitles(const anime::Item& anime_item, bool erase_ids) {
   const int anime_id = anime_item.GetId();
 
+  InvalidateCache();
+
+  // Remove previous titles from the trigram index
+  for (const auto& trigrams : db_[anime_id].trigrams) {
+    for (const auto& trigram : trigrams) {
+      auto it = trigram_index_.find(GetTrigramKey(trigram));
+      if (it == trigram_index_.end())
+        continue;
+      auto& postings = it->second;
+      postings.erase(std::remove_if(postings.begin(), postings.end(),
+          [&anime_id](const TrigramPosting& posting) {
+            return posting.anime_id == anime_id;
+          }), postings.end());
+      if (postings.empty())
+        trigram_index_.erase(it);
+    }
+  }
+
   db_[anime_id].normal_titles.clear();
   db_[anime_id].trigrams.clear();
 
@@ -250,6 +386,10 @@ void Engine::UpdateTitles(const anime::Item& anime_item, bool erase_ids) {
       Normalize(title, kNormalizeForTrigrams, false);
       trigram_container_t trigrams;
       GetTrigrams(title, trigrams);
+      const size_t title_index = db_[anime_id].trigrams.size();
+      for (const auto& trigram : trigrams) {
+        trigram_index_[GetTrigramKey(trigram)].push_back({anime_id, title_index});
+      }
       db_[anime_id].trigrams.push_back(trigrams);
       db_[anime_id].normal_titles.push_back(title);
 
@@ -353,7 +493,7 @@ void Engine::ExtendAnimeTitle(anime::Episode& episode) const {
   }
 }
 
-bool Engine::GetTitleFromPath(anime::Episode& episode) {
+bool Engine::GetTitleFromPath(anime::Episode& episode) const {
   if (episode.folder.empty())
     return false;
 
@@ -386,11 +526,7 @@ bool Engine::GetTitleFromPath(anime::Episode& episode) {
   };
 
   auto get_season_number = [](const std::wstring& str) {
-    anitomy::Anitomy anitomy_instance;
-    anitomy_instance.options().parse_episode_number = false;
-    anitomy_instance.options().parse_episode_title = false;
-    anitomy_instance.options().parse_file_extension = false;
-    anitomy_instance.options().parse_release_group = false;
+    auto& anitomy_instance = GetParser(ParserType::DirectorySeason);
     anitomy_instance.Parse(str);
     auto it = anitomy_instance.elements().find(anitomy::kElementAnimeSeason);
     if (it != anitomy_instance.elements().end())
@@ -423,11 +559,7 @@ bool Engine::GetTitleFromPath(anime::Episode& episode) {
   } else {
     // We're parsing the directory name in case it looks like
     // "[Fansub] Anime Title [Stuff]" rather than just "Anime Title".
-    anitomy::Anitomy anitomy_instance;
-    anitomy_instance.options().parse_episode_number = false;
-    anitomy_instance.options().parse_episode_title = false;
-    anitomy_instance.options().parse_file_extension = false;
-    anitomy_instance.options().parse_release_group = true;
+    auto& anitomy_instance = GetParser(ParserType::DirectoryTitle);
     if (anitomy_instance.Parse(episode.anime_title())) {
       auto& elements = anitomy_instance.elements();
       const auto valid_elements = {
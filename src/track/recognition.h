@@ -19,14 +19,16 @@
 #pragma once
 
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/string.h"
+#include "library/anime_episode.h"
 
 namespace anime {
-class Episode;
 class Item;
 }
 
@@ -53,13 +55,20 @@ class Engine {
 public:
   bool Parse(std::wstring filename, const ParseOptions& parse_options, anime::Episode& episode) const;
   int Identify(anime::Episode& episode, bool give_score, const MatchOptions& match_options);
-  bool Search(const std::wstring& title, std::vector<int>& anime_ids);
+  void IdentifyBatch(const std::vector<std::wstring>& filenames, const ParseOptions& parse_options, const MatchOptions& match_options, std::vector<anime::Episode>& episodes);
+  bool Recognize(const std::wstring& str, const ParseOptions& parse_options, const MatchOptions& match_options, anime::Episode& episode);
+  bool Search(const std::wstring& title, std::vector<int>& anime_ids, bool use_trigram_index = true);
 
   void InitializeTitles();
   void UpdateTitles(const anime::Item& anime_item, bool erase_ids = false);
 
   sorted_scores_t GetScores() const;
 
+  void InvalidateCache();
+  void InvalidateParsers();
+  bool LoadCache();
+  bool SaveCache();
+
   bool IsBatchRelease(const anime::Episode& episode) const;
   bool IsValidAnimeType(const anime::Episode& episode) const;
   bool IsValidAnimeType(const std::wstring& path, const ParseOptions& parse_options) const;
@@ -80,16 +89,22 @@ private:
     kNormalizeFull,
   };
 
+  int Identify(anime::Episode& episode, bool give_score, const MatchOptions& match_options, sorted_scores_t& scores) const;
+  bool Recognize(const std::wstring& str, const ParseOptions& parse_options, const MatchOptions& match_options, anime::Episode& episode, sorted_scores_t& scores);
+
+  void CheckCacheContext();
+  std::wstring GetCacheSignature() const;
+
   bool ValidateOptions(anime::Episode& episode, int anime_id, const MatchOptions& match_options, bool redirect) const;
   bool ValidateOptions(anime::Episode& episode, const anime::Item& anime_item, const MatchOptions& match_options, bool redirect) const;
   bool ValidateEpisodeNumber(anime::Episode& episode, const anime::Item& anime_item, const MatchOptions& match_options, bool redirect) const;
 
   int LookUpTitle(std::wstring title, std::set<int>& anime_ids) const;
-  bool GetTitleFromPath(anime::Episode& episode);
+  bool GetTitleFromPath(anime::Episode& episode) const;
   void ExtendAnimeTitle(anime::Episode& episode) const;
 
-  int ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids, const MatchOptions& match_options);
-  int ScoreTitle(const std::wstring& str, const anime::Episode& episode, const scores_t& trigram_results);
+  int ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids, const MatchOptions& match_options, sorted_scores_t& scores, bool use_trigram_index = true) const;
+  int ScoreTitle(const std::wstring& str, const anime::Episode& episode, const scores_t& trigram_results, sorted_scores_t& scores) const;
 
   void Normalize(std::wstring& title, int type, bool normalized_before) const;
   void NormalizeUnicode(std::wstring& str) const;
@@ -112,6 +127,29 @@ private:
     std::vector<trigram_container_t> trigrams;
   };
   std::map<int, ScoreStore> db_;
+
+  // Maps each trigram to the titles that contain it, so that we can skip the
+  // entries that have nothing in common with the title we're looking for
+  struct TrigramPosting {
+    int anime_id;
+    size_t title_index;
+  };
+  std::map<trigram_t, std::vector<TrigramPosting>> trigram_index_;
+
+  // Recognition results are cached by input and options. Entries that belong
+  // to a previous generation are stale, which allows us to invalidate the
+  // whole cache at once whenever titles, relations or settings change.
+  struct CacheEntry {
+    anime::Episode episode;
+    bool parsed = false;
+    unsigned int generation = 0;
+  };
+  std::unordered_map<std::wstring, CacheEntry> cache_;
+  std::wstring cache_context_;
+  unsigned int cache_generation_ = 0;
+  bool cache_modified_ = false;
+  std::mutex cache_mutex_;
+
   sorted_scores_t scores_;
 };
 
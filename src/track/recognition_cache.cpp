@@ -0,0 +1,256 @@
+/*
+** Taiga
+** Copyright (C) 2010-2018, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/log.h"
+#include "base/string.h"
+#include "base/time.h"
+#include "base/xml.h"
+#include "library/anime.h"
+#include "library/anime_db.h"
+#include "library/anime_episode.h"
+#include "taiga/path.h"
+#include "taiga/settings.h"
+#include "taiga/taiga.h"
+#include "track/recognition.h"
+
+namespace track {
+namespace recognition {
+
+constexpr size_t kMaxCacheSize = 50000;
+
+static std::wstring GetCacheKey(const std::wstring& str,
+                                const ParseOptions& parse_options,
+                                const MatchOptions& match_options) {
+  const UINT options = (parse_options.parse_path << 0) |
+                       (parse_options.streaming_media << 1) |
+                       (match_options.allow_sequels << 2) |
+                       (match_options.check_airing_date << 3) |
+                       (match_options.check_anime_type << 4) |
+                       (match_options.check_episode_number << 5) |
+                       (match_options.streaming_media << 6);
+  return ToWstr(options) + L":" + str;
+}
+
+// FNV-1a, with a terminator so that adjacent strings can't be confused
+static void HashString(UINT64& hash, const std::wstring& str) {
+  constexpr UINT64 kPrime = 1099511628211ULL;
+  for (const auto c : str) {
+    hash ^= static_cast<UINT64>(c);
+    hash *= kPrime;
+  }
+  hash ^= 0xFFFF;
+  hash *= kPrime;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Engine::Recognize(const std::wstring& str,
+                       const ParseOptions& parse_options,
+                       const MatchOptions& match_options,
+                       anime::Episode& episode) {
+  InitializeTitles();
+  CheckCacheContext();
+
+  sorted_scores_t scores;
+  return Recognize(str, parse_options, match_options, episode, scores);
+}
+
+bool Engine::Recognize(const std::wstring& str,
+                       const ParseOptions& parse_options,
+                       const MatchOptions& match_options,
+                       anime::Episode& episode, sorted_scores_t& scores) {
+  const auto key = GetCacheKey(str, parse_options, match_options);
+  unsigned int generation = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = cache_.find(key);
+    if (it != cache_.end() && it->second.generation == cache_generation_) {
+      episode = it->second.episode;
+      return it->second.parsed;
+    }
+    generation = cache_generation_;
+  }
+
+  const bool parsed = Parse(str, parse_options, episode);
+  if (parsed)
+    Identify(episode, false, match_options, scores);
+
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+
+  if (cache_.size() >= kMaxCacheSize) {
+    for (auto it = cache_.begin(); it != cache_.end(); ) {
+      if (it->second.generation != cache_generation_) {
+        it = cache_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (cache_.size() >= kMaxCacheSize)
+      cache_.clear();
+  }
+
+  // If the cache was invalidated in the meantime, the entry is already stale
+  auto& entry = cache_[key];
+  entry.episode = episode;
+  entry.parsed = parsed;
+  entry.generation = generation;
+  cache_modified_ = true;
+
+  return parsed;
+}
+
+void Engine::InvalidateCache() {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  ++cache_generation_;
+}
+
+void Engine::CheckCacheContext() {
+  // Results also depend on these settings, and on the current date (e.g. when
+  // checking whether an anime has started airing, or when guessing the last
+  // aired episode). Since the context is a part of the signature, the cache
+  // on disk is only reused on the same day.
+  std::wstring context = Settings[taiga::kRecognition_IgnoredStrings];
+  context += Settings.GetBool(taiga::kRecognition_LookupParentDirectories) ?
+      L"|1" : L"|0";
+  for (const auto& library_folder : Settings.library_folders) {
+    context += L"|" + library_folder;
+  }
+  context += L"|" + GetDate().to_string();
+
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  if (context != cache_context_) {
+    cache_context_ = context;
+    ++cache_generation_;
+  }
+}
+
+std::wstring Engine::GetCacheSignature() const {
+  // The generation counter is not persistent, so we identify the data that the
+  // results were based on instead
+  UINT64 hash = 14695981039346656037ULL;
+
+  HashString(hash, StrToWstr(Taiga.version.to_string()));
+  HashString(hash, cache_context_);
+  HashString(hash, Settings[taiga::kRecognition_RelationsLastModified]);
+
+  for (const auto& it : AnimeDatabase.items) {
+    const auto& anime_item = it.second;
+    HashString(hash, ToWstr(anime_item.GetId()));
+    HashString(hash, anime_item.GetTitle());
+    HashString(hash, anime_item.GetEnglishTitle());
+    HashString(hash, anime_item.GetJapaneseTitle());
+    for (const auto& synonym : anime_item.GetSynonyms()) {
+      HashString(hash, synonym);
+    }
+    for (const auto& synonym : anime_item.GetUserSynonyms()) {
+      HashString(hash, synonym);
+    }
+    HashString(hash, anime_item.GetDateStart().to_string());
+    HashString(hash, anime_item.GetDateEnd().to_string());
+    HashString(hash, ToWstr(anime_item.GetAiringStatus(false)));
+    HashString(hash, ToWstr(anime_item.GetEpisodeCount()));
+    HashString(hash, ToWstr(anime_item.GetLastAiredEpisodeNumber()));
+  }
+
+  return ToWstr(hash);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Engine::LoadCache() {
+  xml_document document;
+  std::wstring path = taiga::GetPath(taiga::Path::DatabaseRecognitionCache);
+  xml_parse_result parse_result = document.load_file(path.c_str());
+
+  if (parse_result.status != pugi::status_ok)
+    return false;
+
+  CheckCacheContext();
+
+  xml_node node_meta = document.child(L"meta");
+  if (XmlReadStrValue(node_meta, L"signature") != GetCacheSignature()) {
+    LOGD(L"Recognition cache is out of date.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+
+  xml_node node_cache = document.child(L"cache");
+  foreach_xmlnode_(node_item, node_cache, L"item") {
+    auto& entry = cache_[node_item.attribute(L"key").as_string()];
+    entry.episode.Clear();
+    entry.episode.anime_id = node_item.attribute(L"id").as_int(anime::ID_UNKNOWN);
+    entry.episode.folder = node_item.attribute(L"folder").as_string();
+    foreach_xmlnode_(node_element, node_item, L"element") {
+      const auto category = static_cast<anitomy::ElementCategory>(
+          node_element.attribute(L"category").as_int());
+      entry.episode.elements().insert(category, node_element.child_value());
+    }
+    entry.parsed = node_item.attribute(L"parsed").as_bool();
+    entry.generation = cache_generation_;
+  }
+
+  cache_modified_ = false;
+
+  return true;
+}
+
+bool Engine::SaveCache() {
+  if (!cache_modified_)
+    return false;
+
+  CheckCacheContext();
+
+  xml_document document;
+  std::wstring path = taiga::GetPath(taiga::Path::DatabaseRecognitionCache);
+
+  xml_node node_meta = document.append_child(L"meta");
+  XmlWriteStrValue(node_meta, L"version", StrToWstr(Taiga.version.to_string()).c_str());
+  XmlWriteStrValue(node_meta, L"signature", GetCacheSignature().c_str());
+
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+
+  xml_node node_cache = document.append_child(L"cache");
+  for (const auto& it : cache_) {
+    const auto& entry = it.second;
+    if (entry.generation != cache_generation_)
+      continue;
+    xml_node node_item = node_cache.append_child(L"item");
+    node_item.append_attribute(L"key") = it.first.c_str();
+    node_item.append_attribute(L"parsed") = entry.parsed;
+    node_item.append_attribute(L"id") = entry.episode.anime_id;
+    if (!entry.episode.folder.empty())
+      node_item.append_attribute(L"folder") = entry.episode.folder.c_str();
+    for (const auto& element : entry.episode.elements()) {
+      xml_node node_element = node_item.append_child(L"element");
+      node_element.append_attribute(L"category") = static_cast<int>(element.first);
+      node_element.append_child(pugi::node_pcdata).set_value(element.second.c_str());
+    }
+  }
+
+  if (!XmlWriteDocumentToFile(document, path))
+    return false;
+
+  cache_modified_ = false;
+
+  return true;
+}
+
+}  // namespace recognition
+}  // namespace track
@@ -153,6 +153,7 @@ bool Engine::ReadRelations() {
 
 bool Engine::ReadRelations(const std::string& document) {
   relations.clear();
+  InvalidateCache();
 
   std::vector<std::wstring> lines;
   Split(StrToWstr(document), L"\n", lines);
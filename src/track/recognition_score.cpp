@@ -32,7 +32,8 @@ sorted_scores_t Engine::GetScores() const {
 }
 
 int Engine::ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids,
-                       const MatchOptions& match_options) {
+                       const MatchOptions& match_options,
+                       sorted_scores_t& scores, bool use_trigram_index) const {
   scores_t trigram_results;
 
   auto normal_title = episode.anime_title();
@@ -41,12 +42,20 @@ int Engine::ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids,
   trigram_container_t t1;
   GetTrigrams(normal_title, t1);
 
+  auto calculate_trigram_result = [&](int anime_id,
+                                      const trigram_container_t& t2) {
+    double result = CompareTrigrams(t1, t2);
+    if (result > 0.1) {
+      auto& target = trigram_results[anime_id];
+      target = std::max(target, result);
+    }
+  };
+
   auto calculate_trigram_results = [&](int anime_id) {
-    for (const auto& t2 : db_[anime_id].trigrams) {
-      double result = CompareTrigrams(t1, t2);
-      if (result > 0.1) {
-        auto& target = trigram_results[anime_id];
-        target = std::max(target, result);
+    auto it = db_.find(anime_id);
+    if (it != db_.end()) {
+      for (const auto& t2 : it->second.trigrams) {
+        calculate_trigram_result(anime_id, t2);
       }
     }
   };
@@ -55,6 +64,29 @@ int Engine::ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids,
     for (const auto& id : anime_ids) {
       calculate_trigram_results(id);
     }
+  } else if (use_trigram_index) {
+    // Titles that don't share a single trigram with ours would have a result
+    // of zero, so we only need to look at the ones in the posting lists.
+    std::map<int, std::set<size_t>> candidates;
+    for (const auto& trigram : t1) {
+      auto it = trigram_index_.find(GetTrigramKey(trigram));
+      if (it != trigram_index_.end()) {
+        for (const auto& posting : it->second) {
+          candidates[posting.anime_id].insert(posting.title_index);
+        }
+      }
+    }
+    for (const auto& candidate : candidates) {
+      const int id = candidate.first;
+      auto anime_item = AnimeDatabase.FindItem(id, false);
+      if (!anime_item ||
+          !ValidateOptions(episode, *anime_item, match_options, false))
+        continue;
+      const auto& trigrams = db_.at(id).trigrams;
+      for (const auto& title_index : candidate.second) {
+        calculate_trigram_result(id, trigrams.at(title_index));
+      }
+    }
   } else {
     for (const auto& it : AnimeDatabase.items) {
       if (ValidateOptions(episode, it.second, match_options, false))
@@ -62,7 +94,7 @@ int Engine::ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids,
     }
   }
 
-  return ScoreTitle(normal_title, episode, trigram_results);
+  return ScoreTitle(normal_title, episode, trigram_results, scores);
 }
 
 static double CustomScore(const std::wstring& title, const std::wstring& str) {
@@ -113,16 +145,17 @@ static double BonusScore(const anime::Episode& episode, int id) {
 };
 
 int Engine::ScoreTitle(const std::wstring& str, const anime::Episode& episode,
-                       const scores_t& trigram_results) {
+                       const scores_t& trigram_results,
+                       sorted_scores_t& scores) const {
   scores_t jaro_winkler, levenshtein, custom, bonus;
 
-  scores_.clear();
+  scores.clear();
 
   for (const auto& trigram_result : trigram_results) {
     int id = trigram_result.first;
 
     // Calculate individual scores for all titles
-    for (auto& title : db_[id].normal_titles) {
+    for (auto& title : db_.at(id).normal_titles) {
       jaro_winkler[id] = std::max(jaro_winkler[id], JaroWinklerDistance(title, str));
       levenshtein[id] = std::max(levenshtein[id], LevenshteinDistance(title, str));
       custom[id] = std::max(custom[id], CustomScore(title, str));
@@ -136,23 +169,23 @@ int Engine::ScoreTitle(const std::wstring& str, const anime::Episode& episode,
           (0.3 * std::pow(levenshtein[id], 0.8)) +
           (0.2 * std::pow(trigram_result.second, 0.8))) / 2.0) + bonus[id];
     if (score >= 0.3)
-      scores_.push_back(std::make_pair(id, score));
+      scores.push_back(std::make_pair(id, score));
   }
 
   // Sort scores in descending order, then limit the results
-  std::stable_sort(scores_.begin(), scores_.end(),
+  std::stable_sort(scores.begin(), scores.end(),
       [&](const std::pair<int, double>& a,
           const std::pair<int, double>& b) {
         return a.second > b.second;
       });
-  if (scores_.size() > 20)
-    scores_.resize(20);
+  if (scores.size() > 20)
+    scores.resize(20);
 
-  double score_1st = scores_.size() > 0 ? scores_.at(0).second : 0.0;
-  double score_2nd = scores_.size() > 1 ? scores_.at(1).second : 0.0;
+  double score_1st = scores.size() > 0 ? scores.at(0).second : 0.0;
+  double score_2nd = scores.size() > 1 ? scores.at(1).second : 0.0;
 
   if (score_1st >= 1.0 && score_1st != score_2nd)
-    return scores_.front().first;
+    return scores.front().first;
 
   return anime::ID_UNKNOWN;
 }
@@ -196,8 +196,8 @@ void PageSeriesInfo::Refresh(int anime_id, bool connect) {
          anime::TranslateNumber(anime_item->GetEpisodeCount(), L"Unknown") + L"\n" +
          anime::TranslateStatus(anime_item->GetAiringStatus()) + L"\n" +
          anime::TranslateDateToSeasonString(anime_item->GetDateStart()) + L"\n" +
-         (anime_item->GetGenres().empty() ? L"Unknown" : Join(anime_item->GetGenres(), L", ")) + L"\n" +
-         (anime_item->GetProducers().empty() ? L"Unknown" : Join(anime_item->GetProducers(), L", ")) + L"\n" +
+         (anime_item->GetGenreIds().empty() ? L"Unknown" : anime_item->GetJoinedGenres()) + L"\n" +
+         (anime_item->GetProducerIds().empty() ? L"Unknown" : anime_item->GetJoinedProducers()) + L"\n" +
          anime::TranslateScore(anime_item->GetScore());
   SetDlgItemText(IDC_STATIC_ANIME_DETAILS, text.c_str());
 
@@ -247,10 +247,10 @@ LRESULT SeasonDialog::OnListNotify(LPARAM lParam) {
             text += ToWstr(anime_item->GetPopularity()) + L" users";
             break;
         }
-        if (!anime_item->GetGenres().empty())
-          text += L"\n" + Join(anime_item->GetGenres(), L", ");
-        if (!anime_item->GetProducers().empty())
-          text += L"\n" + Join(anime_item->GetProducers(), L", ");
+        if (!anime_item->GetGenreIds().empty())
+          text += L"\n" + anime_item->GetJoinedGenres();
+        if (!anime_item->GetProducerIds().empty())
+          text += L"\n" + anime_item->GetJoinedProducers();
         tooltips_.UpdateText(0, text.c_str());
       }
       break;
@@ -472,11 +472,11 @@ LRESULT SeasonDialog::OnListCustomDraw(LPARAM lParam) {
       text += L" (" + anime::TranslateStatus(anime_item->GetAiringStatus()) + L")";
       DRAWLINE(text);
       DRAWLINE(anime::TranslateNumber(anime_item->GetEpisodeCount(), L"Unknown"));
-      DRAWLINE(anime_item->GetGenres().empty() ? L"?" : Join(anime_item->GetGenres(), L", "));
+      DRAWLINE(anime_item->GetGenreIds().empty() ? L"?" : anime_item->GetJoinedGenres().c_str());
       switch (current_service) {
         case sync::kMyAnimeList:
         case sync::kAniList:
-          DRAWLINE(anime_item->GetProducers().empty() ? L"?" : Join(anime_item->GetProducers(), L", "));
+          DRAWLINE(anime_item->GetProducerIds().empty() ? L"?" : anime_item->GetJoinedProducers().c_str());
           break;
       }
       DRAWLINE(anime::TranslateScore(anime_item->GetScore()));
@@ -646,8 +646,8 @@ void SeasonDialog::RefreshList(bool redraw_only) {
     if (!anime_item)
       continue;
     bool passed_filters = true;
-    std::wstring genres = Join(anime_item->GetGenres(), L", ");
-    std::wstring producers = Join(anime_item->GetProducers(), L", ");
+    const auto& genres = anime_item->GetJoinedGenres();
+    const auto& producers = anime_item->GetJoinedProducers();
     for (auto j = filters.begin(); passed_filters && j != filters.end(); ++j) {
       if (InStr(genres, *j, 0, true) == -1 &&
           InStr(producers, *j, 0, true) == -1 &&
@@ -232,8 +232,7 @@ void MenuList::UpdateExternalLinks() {
     // Clear menu
     menu->items.clear();
 
-    std::vector<std::wstring> lines;
-    Split(Settings[taiga::kApp_Interface_ExternalLinks], L"\r\n", lines);
+    const auto& lines = Settings.GetList(taiga::kApp_Interface_ExternalLinks);
     for (const auto& line : lines) {
       if (IsEqual(line, L"-")) {
         // Add separator
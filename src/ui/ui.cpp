@@ -359,11 +359,19 @@ void OnLibraryEntryChangeFailure(int id, const string_t& reason) {
 }
 
 void OnLibraryUpdateFailure(int id, const string_t& reason, bool not_approved) {
-  auto anime_item = AnimeDatabase.FindItem(id);
+  OnLibraryUpdateFailure(std::vector<int>{id}, reason, not_approved);
+}
 
+void OnLibraryUpdateFailure(const std::vector<int>& ids, const string_t& reason,
+                            bool not_approved) {
   std::wstring text;
-  if (anime_item)
-    text += L"Title: " + anime::GetPreferredTitle(*anime_item) + L"\n";
+  if (ids.size() == 1) {
+    auto anime_item = AnimeDatabase.FindItem(ids.front());
+    if (anime_item)
+      text += L"Title: " + anime::GetPreferredTitle(*anime_item) + L"\n";
+  } else {
+    text += L"Entries: " + ToWstr(static_cast<int>(ids.size())) + L"\n";
+  }
 
   if (not_approved) {
     text += L"Reason: Taiga won't be able to synchronize your list until MAL "
@@ -78,6 +78,7 @@ void OnLibraryGetSeason();
 void OnLibrarySearchTitle(int id, const string_t& results);
 void OnLibraryEntryChangeFailure(int id, const string_t& reason);
 void OnLibraryUpdateFailure(int id, const string_t& reason, bool not_approved);
+void OnLibraryUpdateFailure(const std::vector<int>& ids, const string_t& reason, bool not_approved);
 
 bool OnLibraryEntriesEditDelete(const std::vector<int> ids);
 int OnLibraryEntriesEditEpisode(const std::vector<int> ids);